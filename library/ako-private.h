@@ -23,6 +23,21 @@
 #define AKO_EXPORT __attribute__((visibility("default")))
 
 
+// Simd kernels (x86-64 only for now, where Sse2 is a given, and the rest gets
+// checked at runtime). Building with AKO_NO_SIMD=1 leaves only scalar code.
+// Avx kernels finishing their tails in a Sse one call _mm256_zeroupper() right
+// before, compilers don't always emit it on tail calls and mixing both without
+// it stalls every Sse instruction that follows
+#if (AKO_NO_SIMD == 0) && defined(__GNUC__) && (defined(__x86_64__) || defined(_M_X64))
+#define AKO_SIMD_X86 1
+#define AKO_TARGET_SSE4_1 __attribute__((target("sse4.1")))
+#define AKO_TARGET_AVX2 __attribute__((target("avx2")))
+#define AKO_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#else
+#define AKO_SIMD_X86 0
+#endif
+
+
 typedef int16_t coeff_t;   // For future monomorphization...
 typedef uint16_t ucoeff_t; // Ditto
 
@@ -32,11 +47,79 @@ struct akoLiftHead
 	int16_t quantization;
 };
 
+#define AKO_MAX_LIFTS 64 // Dimensions halve every lift, so enough for any size_t
+
+struct akoQuantizationTable // Quantization and gate for all lifts of a tile shape
+{
+	size_t tile_w; // Zero if not filled
+	size_t tile_h;
+	int16_t q[2][AKO_MAX_LIFTS]; // Luma, chroma; first lift first
+	int16_t g[2][AKO_MAX_LIFTS];
+};
+
+struct akoReciprocal // Divides as: ((n * mul) >> 16 + (add ? n : 0)) >> shift, plus one if n is negative
+{
+	int16_t mul;
+	int16_t shift;
+	int16_t add;
+};
+
 // compression.c:
 
-size_t akoCompress(enum akoCompression, size_t channels, size_t tile_w, size_t tile_h, coeff_t* input, void* output);
-size_t akoDecompress(enum akoCompression, size_t decompressed_size, size_t output_size, const void* input,
-                     void* output);
+size_t akoCompress(enum akoCompression, enum akoWavelet, size_t channels, size_t tile_w, size_t tile_h,
+                   size_t input_size, size_t output_size, coeff_t* input, void* output, void* scratch);
+size_t akoCompressedSize(enum akoCompression, size_t input_size, const void* input);
+size_t akoDecompress(enum akoCompression, enum akoWavelet, size_t channels, size_t tile_w, size_t tile_h,
+                     size_t decompressed_size, size_t prefix_size, size_t output_size, size_t input_size,
+                     const void* input, void* output);
+
+// cpu.c:
+
+struct akoKernels
+{
+	enum akoSimd simd;
+
+	// Wavelets interior, from column 'c' to 'end'. Return where they stopped
+	size_t (*cdf53_hp_row)(size_t c, size_t end, const int16_t* odd, const int16_t* even, const int16_t* even_p1,
+	                       int16_t* out);
+	size_t (*cdf53_lp_row)(size_t c, size_t end, const int16_t* even, const int16_t* hp_l1, const int16_t* hp,
+	                       int16_t* out);
+	size_t (*cdf53_even_row)(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp, const int16_t* hp_l1,
+	                         const int16_t* hp, int16_t* out); // Inverse quantizing inputs
+	size_t (*cdf53_odd_row)(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even,
+	                        const int16_t* even_p1, int16_t* out);
+	size_t (*cdf53_hp_interleaved)(size_t c, size_t end, const int16_t* in, int16_t* out_hp);
+	size_t (*cdf53_lp_interleaved)(size_t c, size_t end, const int16_t* in, const int16_t* hp, int16_t* out_lp);
+	size_t (*cdf53_unlift_interleaved)(size_t c, size_t end, const int16_t* lp, const int16_t* hp, int16_t* out);
+
+	size_t (*dd137_hp_row)(size_t c, size_t end, const int16_t* odd, const int16_t* even_l1, const int16_t* even,
+	                       const int16_t* even_p1, const int16_t* even_p2, int16_t* out);
+	size_t (*dd137_lp_row)(size_t c, size_t end, const int16_t* even, const int16_t* hp_l2, const int16_t* hp_l1,
+	                       const int16_t* hp, const int16_t* hp_p1, int16_t* out);
+	size_t (*dd137_even_row)(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp, const int16_t* hp_l2,
+	                         const int16_t* hp_l1, const int16_t* hp, const int16_t* hp_p1, int16_t* out);
+	size_t (*dd137_odd_row)(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even_l1,
+	                        const int16_t* even, const int16_t* even_p1, const int16_t* even_p2, int16_t* out);
+	size_t (*dd137_hp_interleaved)(size_t c, size_t end, const int16_t* in, int16_t* out_hp);
+	size_t (*dd137_lp_interleaved)(size_t c, size_t end, const int16_t* in, const int16_t* hp, int16_t* out_lp);
+	size_t (*dd137_unlift_interleaved)(size_t c, size_t end, const int16_t* lp, const int16_t* hp, int16_t* out);
+
+	// Quantization, same as above
+	size_t (*quantize)(size_t c, size_t end, const struct akoReciprocal* q, int16_t g, const int16_t* in,
+	                   int16_t* out); // And gate
+
+	// Format, a row from column 'c' to 'end', deinterleaving and converting to Yuv
+	size_t (*format_rgb_to_yuv)(enum akoColor, int discard_non_visible, size_t c, size_t end, size_t out_plane,
+	                            const uint8_t* in, int16_t* out);
+	size_t (*format_rgba_to_yuv)(enum akoColor, int discard_non_visible, size_t c, size_t end, size_t out_plane,
+	                             const uint8_t* in, int16_t* out);
+	size_t (*format_yuv_to_rgb)(enum akoColor, size_t c, size_t end, size_t in_plane, const int16_t* in,
+	                            uint8_t* out); // And saturating and interleaving back
+	size_t (*format_yuva_to_rgba)(enum akoColor, size_t c, size_t end, size_t in_plane, const int16_t* in,
+	                              uint8_t* out);
+};
+
+const struct akoKernels* akoKernels(); // Filled at first use
 
 // developer.c:
 
@@ -45,10 +128,13 @@ void akoSavePgmI16(size_t width, size_t height, size_t in_stride, const int16_t*
 // format.c:
 
 void akoFormatToPlanarI16Yuv(int discard_non_visible, enum akoColor, size_t channels, size_t width, size_t height,
-                             size_t in_stride, size_t out_planes_spacing, const uint8_t* in, int16_t* out);
+                             size_t in_stride, size_t out_planes_spacing, const uint8_t* in,
+                             int16_t* out); // Stride in bytes
 void akoFormatToInterleavedU8Rgb(enum akoColor, size_t channels, size_t width, size_t height, size_t in_planes_spacing,
-                                 size_t out_stride, int16_t* in,
-                                 uint8_t* out); // Destroys 'in'
+                                 size_t region_x, size_t region_y, size_t region_w, size_t region_h, size_t out_pitch,
+                                 size_t out_stride, int16_t* in, uint8_t* out); // Destroys 'in', pitch/stride in bytes
+
+void akoFormatKernels(enum akoSimd, struct akoKernels*);
 
 // head.c:
 
@@ -56,6 +142,10 @@ enum akoStatus akoHeadWrite(size_t channels, size_t image_w, size_t image_h, con
 enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_image_w, size_t* out_image_h,
                            struct akoSettings* out_s);
 
+size_t akoIndexSize(size_t tiles_no);
+void akoIndexWrite(size_t tile_no, size_t offset, void* index);
+size_t akoIndexRead(size_t tile_no, const void* index);
+
 // kagari.c
 
 #define AKO_ELIAS_ACCUMULATOR_LEN 64 // In bits
@@ -73,15 +163,24 @@ size_t akoEliasEncodeEnd(struct akoEliasState* s, uint8_t** cursor, const uint8_
 
 uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, const uint8_t* end, int* out_bits);
 
-size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input, void* output);
-size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output);
+size_t akoKagariEncode(enum akoWavelet, size_t channels, size_t tile_w, size_t tile_h, size_t input_size,
+                       size_t output_size, const void* input, void* output);
+size_t akoKagariDecode(enum akoWavelet, size_t channels, size_t tile_w, size_t tile_h, size_t no, size_t input_size,
+                       size_t output_size, const void* input, void* output);
 
 // lifting.c
 
-void akoLift(size_t tile_no, const struct akoSettings*, size_t channels, size_t tile_w, size_t tile_h,
-             size_t planes_space, int16_t* in, int16_t* output);
+void akoLift(size_t tile_no, const struct akoSettings*, const struct akoQuantizationTable*, size_t channels,
+             size_t tile_w, size_t tile_h, size_t planes_space, int16_t* in, int16_t* output);
 void akoUnlift(const struct akoSettings* s, size_t channels, size_t tile_no, size_t tile_w, size_t tile_h,
-               size_t out_planes_space, coeff_t* input, coeff_t* out);
+               size_t out_planes_space, size_t skip_lifts, coeff_t* input, coeff_t* out);
+
+void akoLiftingKernels(enum akoSimd, struct akoKernels*);
+
+// manbavaran.c:
+
+size_t akoManbavaranEncode(size_t input_size, size_t output_size, const void* input, void* output);
+size_t akoManbavaranDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output);
 
 // misc.c:
 
@@ -89,7 +188,10 @@ size_t akoDividePlusOneRule(size_t x);
 size_t akoPlanesSpacing(size_t tile_w, size_t tile_h);
 
 size_t akoTileDataSize(size_t tile_w, size_t tile_h);
+size_t akoTileDataPrefixSize(size_t tile_w, size_t tile_h, size_t skip_lifts);
+size_t akoTileLiftsNo(size_t tile_w, size_t tile_h);
 size_t akoTileDimension(size_t tile_pos, size_t image_d, size_t tiles_dimension);
+void akoTilePosition(size_t tile_no, size_t image_w, size_t tiles_dimension, size_t* out_x, size_t* out_y);
 
 size_t akoImageTilesNo(size_t image_w, size_t image_h, size_t tiles_dimension);
 size_t akoImageMaxTileDataSize(size_t image_w, size_t image_h, size_t tiles_dimension);
@@ -109,6 +211,14 @@ void* akoIterateLifts(const struct akoSettings* s, size_t channels, size_t tile_
 int16_t akoGate(int factor, int factor_mul, size_t tile_w, size_t tile_h, size_t current_w, size_t current_h);
 int16_t akoQuantization(int factor, int factor_mul, size_t tile_w, size_t tile_h, size_t current_w, size_t current_h);
 
+void akoQuantizationTable(const struct akoSettings*, size_t tile_w, size_t tile_h, struct akoQuantizationTable* out);
+void akoReciprocal(int16_t d, struct akoReciprocal* out);
+
+// threads.c:
+
+size_t akoThreadsNo(size_t threads, size_t jobs_no);
+void akoThreadsRun(size_t workers_no, void (*worker)(size_t worker_no, void* data), void* data);
+
 // wavelet-cdf53.c:
 
 void akoCdf53LiftH(enum akoWrap, size_t current_h, size_t target_w, size_t fake_last, size_t in_stride,
@@ -117,8 +227,11 @@ void akoCdf53LiftV(enum akoWrap, size_t target_w, size_t target_h, const int16_t
 
 void akoCdf53UnliftH(enum akoWrap, size_t current_w, size_t current_h, size_t out_stride, size_t ignore_last,
                      const int16_t* in_lp, const int16_t* in_hp, int16_t* out);
-void akoCdf53InPlaceishUnliftV(enum akoWrap, size_t current_w, size_t current_h, const int16_t* in_lp,
-                               const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp);
+void akoCdf53InPlaceishUnliftV(enum akoWrap, size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q,
+                               const int16_t* in_lp, const int16_t* in_hp, int16_t* out_lp,
+                               int16_t* out_hp); // Inverse quantizes inputs, 'q' of 1 to just unlift
+
+void akoCdf53Kernels(enum akoSimd, struct akoKernels*);
 
 // wavelet-dd137.c:
 
@@ -128,8 +241,11 @@ void akoDd137LiftV(enum akoWrap, size_t target_w, size_t target_h, const int16_t
 
 void akoDd137UnliftH(enum akoWrap, size_t current_w, size_t current_h, size_t out_stride, size_t ignore_last,
                      const int16_t* in_lp, const int16_t* in_hp, int16_t* out);
-void akoDd137InPlaceishUnliftV(enum akoWrap, size_t current_w, size_t current_h, const int16_t* in_lp,
-                               const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp);
+void akoDd137InPlaceishUnliftV(enum akoWrap, size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q,
+                               const int16_t* in_lp, const int16_t* in_hp, int16_t* out_lp,
+                               int16_t* out_hp); // Ditto
+
+void akoDd137Kernels(enum akoSimd, struct akoKernels*);
 
 // wavelet-haar.c:
 
@@ -139,6 +255,6 @@ void akoHaarLiftV(size_t target_w, size_t target_h, const int16_t* in, int16_t*
 
 void akoHaarUnliftH(size_t current_w, size_t current_h, size_t out_stride, size_t ignore_last, const int16_t* in_lp,
                     const int16_t* in_hp, int16_t* out);
-void akoHaarInPlaceishUnliftV(size_t current_w, size_t current_h, const int16_t* in_lp, const int16_t* in_hp,
-                              int16_t* out_even, int16_t* out_odd);
+void akoHaarInPlaceishUnliftV(size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q, const int16_t* in_lp,
+                              const int16_t* in_hp, int16_t* out_even, int16_t* out_odd);
 #endif
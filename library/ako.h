@@ -9,13 +9,14 @@
 #define AKO_VERSION_MINOR 2
 #define AKO_VERSION_PATCH 0
 
-#define AKO_FORMAT_VERSION 2
+#define AKO_FORMAT_VERSION 3
 
 #define AKO_MAX_CHANNELS 16
 #define AKO_MAX_WIDTH 4294967295
 #define AKO_MAX_HEIGHT 4294967295
 #define AKO_MIN_TILES_DIMENSION 8
 #define AKO_MAX_TILES_DIMENSION 2147483648
+#define AKO_MAX_SCALE 3 // As 2^3 = AKO_MIN_TILES_DIMENSION
 
 
 enum akoStatus
@@ -38,6 +39,8 @@ enum akoStatus
 	AKO_NO_ENOUGH_MEMORY,
 	AKO_INVALID_FLAGS,
 	AKO_BROKEN_INPUT,
+	AKO_INVALID_REGION,
+	AKO_INVALID_SCALE,
 };
 
 enum akoWavelet
@@ -83,6 +86,15 @@ enum akoEvent
 	AKO_EVENT_COMPRESSION_END,
 };
 
+enum akoSimd
+{
+	AKO_SIMD_NONE = 0,
+	AKO_SIMD_SSE2,
+	AKO_SIMD_SSE4_1,
+	AKO_SIMD_AVX2,
+	AKO_SIMD_AVX512,
+};
+
 struct akoSettings
 {
 	enum akoWavelet wavelet;
@@ -96,6 +108,8 @@ struct akoSettings
 
 	int chroma_loss;
 	int discard_non_visible;
+
+	int tiles_index;
 };
 
 struct akoCallbacks
@@ -106,12 +120,15 @@ struct akoCallbacks
 
 	void (*events)(size_t, size_t, enum akoEvent, void*);
 	void* events_data;
+
+	size_t threads; // 0 or 1 = Single thread. Otherwise above callbacks
+	                // should be thread-safe, as workers call them
 };
 
 struct akoHead
 {
 	uint8_t magic[3]; // "Ako"
-	uint8_t version;  // 2 (AKO_FORMAT_VERSION)
+	uint8_t version;  // 3 (AKO_FORMAT_VERSION)
 
 	uint32_t width;  // 0 = Invalid
 	uint32_t height; // Ditto
@@ -123,14 +140,79 @@ struct akoHead
 	// bits 8-9   : Color,           0 = YCOCG, 1 = Subtract Green, 2 = None, 3 = Internal
 	// bits 10-11 : Compression,     0 = Elias Coding, 1 = rAns, 2 = No compression
 	// bits 12-16 : Tiles dimension, 0 = No tiles, 1 = 8x8, 2 = 16x16, 3 = 32x32, 4 = 64x64, etc...
-	// bits 17-32 : Unused bits (always zero)
+	// bit  17    : Tiles index,     0 = No index, 1 = Index follows this head
+	// bits 18-31 : Unused bits (always zero)
 };
 
+// Tiles index, if present, is an array of 'uint64_t' (little-endian) with one
+// entry per tile. Each one is the offset, from the file start, where the tile
+// compressed block begins. Allowing decoders to jump to any tile.
+
 
 size_t akoEncodeExt(const struct akoCallbacks*, const struct akoSettings*, size_t channels, size_t image_w,
                     size_t image_h, const void* in, void** out, enum akoStatus* out_status);
+size_t akoEncodeBound(const struct akoSettings*, size_t channels, size_t image_w, size_t image_h);
+
+// Input stride is in bytes, zero meaning tightly packed rows. Padded frames
+// are encoded as they are, and a sub-rectangle of a bigger image by pointing
+// 'in' to its first pixel with the bigger image stride.
+size_t akoEncodeStrided(const struct akoCallbacks*, const struct akoSettings*, size_t channels, size_t image_w,
+                        size_t image_h, size_t in_stride, const void* in, void** out, enum akoStatus* out_status);
+size_t akoEncodeInto(const struct akoCallbacks*, const struct akoSettings*, size_t channels, size_t image_w,
+                     size_t image_h, size_t in_stride, const void* in, size_t output_size, void* output,
+                     enum akoStatus* out_status); // Output of at least akoEncodeBound() never fails for space
+
+
 uint8_t* akoDecodeExt(const struct akoCallbacks*, size_t input_size, const void* in, struct akoSettings* out_s,
                       size_t* out_channels, size_t* out_w, size_t* out_h, enum akoStatus* out_status);
+uint8_t* akoDecodeRegion(const struct akoCallbacks*, size_t input_size, const void* in, size_t x, size_t y, size_t w,
+                         size_t h, struct akoSettings* out_s, size_t* out_channels, size_t* out_image_w,
+                         size_t* out_image_h, enum akoStatus* out_status);
+uint8_t* akoDecodeScaled(const struct akoCallbacks*, size_t input_size, const void* in, size_t scale,
+                         struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                         enum akoStatus* out_status); // 1 = Half, 2 = Quarter, 3 = Eighth
+enum akoStatus akoDecodeHead(size_t input_size, const void* in, struct akoSettings* out_s, size_t* out_channels,
+                            size_t* out_w, size_t* out_h); // Just the head, to know what akoDecodeInto() needs
+enum akoStatus akoDecodeInto(const struct akoCallbacks*, size_t input_size, const void* in, size_t dst_pitch,
+                             size_t dst_stride, void* dst, struct akoSettings* out_s, size_t* out_channels,
+                             size_t* out_w, size_t* out_h); // Pitch and stride in bytes, zero = tightly packed
+enum akoStatus akoDecodeRows(const struct akoCallbacks*, size_t input_size, const void* in,
+                             void (*rows)(size_t row, size_t rows_no, size_t stride, const uint8_t* data,
+                                          void* user_data),
+                             void* rows_data, struct akoSettings* out_s, size_t* out_channels, size_t* out_w,
+                             size_t* out_h); // Data handed to 'rows' is only valid during the call
+
+struct akoEncodeContext; // Keep workers memory between images, allocation-free once it
+struct akoDecodeContext; // grows to fit the biggest image (and callbacks.threads) seen
+
+struct akoEncodeContext* akoEncodeContextCreate(const struct akoCallbacks*, enum akoStatus* out_status);
+void akoEncodeContextDelete(struct akoEncodeContext*);
+size_t akoEncodeWithContext(struct akoEncodeContext*, const struct akoSettings*, size_t channels, size_t image_w,
+                            size_t image_h, size_t in_stride, const void* in, size_t output_size, void* output,
+                            enum akoStatus* out_status); // As akoEncodeInto()
+
+struct akoDecodeContext* akoDecodeContextCreate(const struct akoCallbacks*, enum akoStatus* out_status);
+void akoDecodeContextDelete(struct akoDecodeContext*);
+enum akoStatus akoDecodeWithContext(struct akoDecodeContext*, size_t input_size, const void* in, size_t dst_pitch,
+                                    size_t dst_stride, void* dst, struct akoSettings* out_s, size_t* out_channels,
+                                    size_t* out_w, size_t* out_h); // As akoDecodeInto()
+
+// A context is not thread-safe, only one encode/decode at time. Workers inside it
+// use as many threads as callbacks given at creation say.
+
+struct akoEncoder; // Streaming encoder, takes the image in rows as they come
+
+struct akoEncoder* akoEncoderBegin(const struct akoCallbacks*, const struct akoSettings*, size_t channels,
+                                   size_t image_w, size_t image_h,
+                                   void (*write)(size_t offset, size_t size, const void* data, void* user_data),
+                                   void* write_data, enum akoStatus* out_status);
+enum akoStatus akoEncoderPushRows(struct akoEncoder*, size_t rows_no, const void* rows);
+size_t akoEncoderFinish(struct akoEncoder*, enum akoStatus* out_status); // Frees encoder, even on errors
+
+// Encoded data is handed to 'write' as soon as a row of tiles is complete, with
+// 'offset' always following previous writes. With one exception: if there is a
+// tiles index, is written (zeroed) after the head, and again with actual values
+// at akoEncoderFinish(), so outputs need to be seekable.
 
 struct akoSettings akoDefaultSettings();
 struct akoCallbacks akoDefaultCallbacks();
@@ -144,4 +226,12 @@ int akoVersionPatch();
 
 int akoFormatVersion();
 
+enum akoSimd akoSimdDetected(); // Best level the cpu has
+enum akoSimd akoSimdInUse();
+enum akoSimd akoSimdLimit(enum akoSimd); // Returns level in use, that can be lower than asked
+
+// Simd level is chosen at first use, lowered by the 'AKO_SIMD' environment variable
+// if set ("none", "sse2", "sse4.1", "avx2" or "avx512"). Output is the same at any
+// level, only speed changes. Don't call akoSimdLimit() while encoding/decoding.
+
 #endif
@@ -29,45 +29,117 @@ SOFTWARE.
 
 struct akoBlockHead
 {
-	uint32_t block_size;
+	uint32_t block_size; // Highest bit set in Manbavaran blocks that Kagari compressed better
 };
 
+#define BLOCK_KAGARI 0x80000000
+#define BLOCK_SIZE_MAX 0x7FFFFFFF
 
-size_t akoCompress(enum akoCompression method, size_t channels, size_t tile_w, size_t tile_h, coeff_t* input,
-                   void* output)
-{
-	(void)method;
-	const size_t input_size = akoTileDataSize(tile_w, tile_h) * channels;
-	const size_t output_size = input_size;
 
-	struct akoBlockHead* h = output;
+size_t akoCompress(enum akoCompression method, enum akoWavelet wavelet, size_t channels, size_t tile_w, size_t tile_h,
+                   size_t input_size, size_t output_size, coeff_t* input, void* output, void* scratch)
+{
+	// Never bigger than the input, is better to fail
+	if (output_size > input_size)
+		output_size = input_size;
+	if (output_size > sizeof(struct akoBlockHead) + BLOCK_SIZE_MAX)
+		output_size = sizeof(struct akoBlockHead) + BLOCK_SIZE_MAX;
+	if (output_size <= sizeof(struct akoBlockHead))
+		return 0;
 
-	const size_t compressed_size = akoKagariEncode(input_size, output_size - sizeof(struct akoBlockHead), input,
-	                                               (uint8_t*)output + sizeof(struct akoBlockHead));
+	const size_t data_size = output_size - sizeof(struct akoBlockHead);
+	uint8_t* data = (uint8_t*)output + sizeof(struct akoBlockHead);
+
+	struct akoBlockHead h;
+	size_t compressed_size = 0;
+	uint32_t flags = 0;
+
+	if (method == AKO_COMPRESSION_MANBAVARAN)
+	{
+		// Frequency tables take up to a few hundred bytes per block, on small tiles (or
+		// heavy quantization) more than what rANS saves. There Kagari does better, so
+		// rANS goes to scratch (of 'input_size' bytes) and has to beat it, otherwise Kagari
+		// stays in place. Encoding each once
+		const size_t kagari_size =
+		    akoKagariEncode(wavelet, channels, tile_w, tile_h, input_size, data_size, input, data);
+		compressed_size =
+		    akoManbavaranEncode(input_size, (kagari_size != 0) ? (kagari_size - 1) : data_size, input, scratch);
+
+		if (compressed_size != 0)
+			__builtin_memcpy(data, scratch, compressed_size);
+		else
+		{
+			compressed_size = kagari_size;
+			flags = BLOCK_KAGARI;
+		}
+	}
+	else
+		compressed_size = akoKagariEncode(wavelet, channels, tile_w, tile_h, input_size, data_size, input, data);
 
 	if (compressed_size == 0)
 		return 0;
 
-	h->block_size = compressed_size;
-	AKO_DEV_PRINTF("E\tCompressed %zu -> %u bytes\n", input_size, h->block_size);
+	// Blocks follow each other with no alignment, so the head goes byte-wise
+	h.block_size = (uint32_t)compressed_size | flags;
+	__builtin_memcpy(output, &h, sizeof(struct akoBlockHead));
+	AKO_DEV_PRINTF("E\tCompressed %zu -> %zu bytes\n", input_size, compressed_size);
 
 	return compressed_size + sizeof(struct akoBlockHead);
 }
 
 
-size_t akoDecompress(enum akoCompression method, size_t decompressed_size, size_t output_size, const void* input,
-                     void* output)
+size_t akoCompressedSize(enum akoCompression method, size_t input_size, const void* input)
 {
-	(void)method;
-	const struct akoBlockHead* h = input;
+	struct akoBlockHead h;
 
-	const size_t compressed_size = akoKagariDecode(decompressed_size / sizeof(int16_t), (size_t)h->block_size,
-	                                               output_size, (uint8_t*)input + sizeof(struct akoBlockHead), output);
+	if (input_size < sizeof(struct akoBlockHead))
+		return 0;
 
-	AKO_DEV_PRINTF("D\tDecompressed %zu <- %u bytes (%zu)\n", decompressed_size, h->block_size, compressed_size);
+	__builtin_memcpy(&h, input, sizeof(struct akoBlockHead));
+	if ((h.block_size & BLOCK_KAGARI) != 0 && method != AKO_COMPRESSION_MANBAVARAN)
+		return 0;
 
-	if (compressed_size == 0 || compressed_size != h->block_size)
+	const size_t block_size = (size_t)(h.block_size & BLOCK_SIZE_MAX);
+	if (block_size > input_size - sizeof(struct akoBlockHead))
 		return 0;
 
-	return compressed_size + sizeof(struct akoBlockHead);
+	return block_size + sizeof(struct akoBlockHead);
+}
+
+
+size_t akoDecompress(enum akoCompression method, enum akoWavelet wavelet, size_t channels, size_t tile_w,
+                     size_t tile_h, size_t decompressed_size, size_t prefix_size, size_t output_size,
+                     size_t input_size, const void* input, void* output)
+{
+	// Decompressing just a prefix, of the 'decompressed_size' the block holds,
+	// is fine. But then we can't check that the whole block was read
+
+	const size_t block_size = akoCompressedSize(method, input_size, input);
+	if (block_size == 0)
+		return 0;
+
+	const size_t data_size = block_size - sizeof(struct akoBlockHead);
+
+	struct akoBlockHead h;
+	__builtin_memcpy(&h, input, sizeof(struct akoBlockHead));
+
+	size_t compressed_size = 0;
+
+	if (method == AKO_COMPRESSION_MANBAVARAN && (h.block_size & BLOCK_KAGARI) == 0)
+		compressed_size = akoManbavaranDecode(prefix_size / sizeof(int16_t), data_size, output_size,
+		                                      (uint8_t*)input + sizeof(struct akoBlockHead), output);
+	else
+		compressed_size = akoKagariDecode(wavelet, channels, tile_w, tile_h, prefix_size / sizeof(int16_t),
+		                                  data_size, output_size,
+		                                  (uint8_t*)input + sizeof(struct akoBlockHead), output);
+
+	AKO_DEV_PRINTF("D\tDecompressed %zu (of %zu) <- %zu bytes (%zu)\n", prefix_size, decompressed_size, data_size,
+	               compressed_size);
+
+	if (compressed_size == 0 || compressed_size > data_size)
+		return 0;
+	if (prefix_size == decompressed_size && compressed_size != data_size)
+		return 0;
+
+	return block_size;
 }
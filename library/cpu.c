@@ -0,0 +1,197 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// Kernels table gets filled once, at first use, for the best Simd level the
+// cpu has. Environment variable 'AKO_SIMD' (none, sse2, sse4.1, avx2, avx512)
+// or akoSimdLimit() can lower it, to benchmark/compare levels.
+
+// Modules fill their own entries, leaving NULL what they don't have for the
+// level, in which case they fall to plain C code.
+
+
+#if (AKO_SIMD_X86 == 1)
+#include <cpuid.h>
+
+static uint64_t sXgetbv(uint32_t index)
+{
+	uint32_t eax;
+	uint32_t edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+	return ((uint64_t)edx << 32) | eax;
+}
+
+static enum akoSimd sDetect()
+{
+	unsigned eax;
+	unsigned ebx;
+	unsigned ecx;
+	unsigned edx;
+
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+		return AKO_SIMD_SSE2; // Always there in x86-64
+	if ((ecx & bit_SSE4_1) == 0)
+		return AKO_SIMD_SSE2;
+
+	// Avx2 needs the OS saving Ymm registers (Xcr0 bits 1 and 2), and Avx512
+	// also the mask and Zmm ones (bits 5, 6 and 7)
+	const uint64_t xcr0 = ((ecx & bit_OSXSAVE) != 0) ? sXgetbv(0) : 0;
+
+	if ((xcr0 & 0x6) != 0x6 || __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0 || (ebx & bit_AVX2) == 0)
+		return AKO_SIMD_SSE4_1;
+	if ((xcr0 & 0xE6) != 0xE6 || (ebx & bit_AVX512F) == 0 || (ebx & bit_AVX512BW) == 0)
+		return AKO_SIMD_AVX2;
+
+	return AKO_SIMD_AVX512;
+}
+#else
+static enum akoSimd sDetect()
+{
+	return AKO_SIMD_NONE;
+}
+#endif
+
+
+#if (AKO_FREESTANDING == 0)
+static int sEqual(const char* a, const char* b)
+{
+	for (; *a != '\0' && *a == *b; a++, b++)
+		;
+	return (*a == *b);
+}
+
+static enum akoSimd sEnvironment(enum akoSimd simd)
+{
+	const char* env = getenv("AKO_SIMD");
+
+	if (env == NULL)
+		return simd;
+
+	if (sEqual(env, "none") != 0)
+		return AKO_SIMD_NONE;
+	if (sEqual(env, "sse2") != 0 && simd > AKO_SIMD_SSE2)
+		return AKO_SIMD_SSE2;
+	if (sEqual(env, "sse4.1") != 0 && simd > AKO_SIMD_SSE4_1)
+		return AKO_SIMD_SSE4_1;
+	if (sEqual(env, "avx2") != 0 && simd > AKO_SIMD_AVX2)
+		return AKO_SIMD_AVX2;
+
+	return simd;
+}
+#endif
+
+
+static struct akoKernels s_kernels;
+static enum akoSimd s_detected;
+static int s_ready = 0;
+static int s_lock = 0;
+
+static void sLock()
+{
+	// Spins, but only while someone else fills the table (no threads and no
+	// lock in builds without Gnu extensions, those are also scalar-only)
+#if defined(__GNUC__)
+	while (__atomic_exchange_n(&s_lock, 1, __ATOMIC_ACQUIRE) != 0)
+		;
+#endif
+}
+
+static void sUnlock()
+{
+#if defined(__GNUC__)
+	__atomic_store_n(&s_lock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+static void sFill(enum akoSimd simd, struct akoKernels* k)
+{
+	k->simd = simd;
+	akoCdf53Kernels(simd, k);
+	akoDd137Kernels(simd, k);
+	akoLiftingKernels(simd, k);
+	akoFormatKernels(simd, k);
+}
+
+
+const struct akoKernels* akoKernels()
+{
+#if defined(__GNUC__)
+	if (__atomic_load_n(&s_ready, __ATOMIC_ACQUIRE) == 0)
+#else
+	if (s_ready == 0)
+#endif
+	{
+		sLock();
+		if (s_ready == 0)
+		{
+			s_detected = sDetect();
+#if (AKO_FREESTANDING == 0)
+			sFill(sEnvironment(s_detected), &s_kernels);
+#else
+			sFill(s_detected, &s_kernels);
+#endif
+
+#if defined(__GNUC__)
+			__atomic_store_n(&s_ready, 1, __ATOMIC_RELEASE);
+#else
+			s_ready = 1;
+#endif
+		}
+		sUnlock();
+	}
+
+	return &s_kernels;
+}
+
+
+AKO_EXPORT enum akoSimd akoSimdDetected()
+{
+	akoKernels();
+	return s_detected;
+}
+
+
+AKO_EXPORT enum akoSimd akoSimdInUse()
+{
+	return akoKernels()->simd;
+}
+
+
+AKO_EXPORT enum akoSimd akoSimdLimit(enum akoSimd simd)
+{
+	akoKernels(); // Detect first
+
+	if (simd > s_detected)
+		simd = s_detected;
+
+	sLock();
+	sFill(simd, &s_kernels);
+	sUnlock();
+
+	return simd;
+}
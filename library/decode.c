@@ -35,124 +35,217 @@ static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent even
 }
 
 
-AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size, const void* input,
-                                 struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
-                                 enum akoStatus* out_status)
+static size_t sTileDataSize(const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
+                            size_t* out_planes_spacing)
 {
-	struct akoSettings s = {0};
-	enum akoStatus status;
+	// Size of data needed to operate per tile.
+	// Both encoder/decoder calculate this value just by reading the
+	// global header at the beginning. Any incongruence is an error.
 
-	size_t channels;
-	size_t image_w;
-	size_t image_h;
+	// Planes spacing is the space in order to follow the akoDividePlusOneRule()
+	// or: "memory between planes to use when needed".
+	// Spacing only lives here, at runtime, is not contained in the file.
+	// Saves us from extra mallocs() and helps with cache locality.
 
-	uint8_t* image = NULL;
-	const uint8_t* blob = input;
+	if (s->wavelet != AKO_WAVELET_NONE)
+	{
+		*out_planes_spacing = akoPlanesSpacing(tile_w, tile_h);
+		return akoTileDataSize(tile_w, tile_h) * channels;
+	}
+
+	*out_planes_spacing = 0; // No DWT, no spacing needed
+	return (tile_w * tile_h * channels * sizeof(int16_t));
+}
 
-	void* workarea_a = NULL;
-	void* workarea_b = NULL;
 
-	// Check callbacks and input
-	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
+static const uint8_t* sLocateTile(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h,
+                                  size_t input_size, const uint8_t* input, const uint8_t* index,
+                                  const uint8_t* from_blob, size_t from_tile, size_t tile_no)
+{
+	const uint8_t* input_end = input + input_size;
 
-	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	// With an index, is just a lookup
+	if (index != NULL)
 	{
-		status = AKO_INVALID_CALLBACKS;
-		goto return_failure;
+		const size_t offset = akoIndexRead(tile_no, index);
+		return (offset <= input_size) ? (input + offset) : NULL;
 	}
 
-	if (input == NULL)
+	// Otherwise walk blocks, reading just their sizes
+	const uint8_t* blob = from_blob;
+	for (size_t t = from_tile; t < tile_no; t++)
 	{
-		status = AKO_INVALID_INPUT;
-		goto return_failure;
-	}
+		size_t tile_x;
+		size_t tile_y;
+		size_t planes_spacing;
+		size_t compressed_size;
+		akoTilePosition(t, image_w, s->tiles_dimension, &tile_x, &tile_y);
+
+		if (s->compression != AKO_COMPRESSION_NONE)
+			compressed_size = akoCompressedSize(s->compression, (size_t)(input_end - blob), blob);
+		else
+			compressed_size = sTileDataSize(s, channels, akoTileDimension(tile_x, image_w, s->tiles_dimension),
+			                                akoTileDimension(tile_y, image_h, s->tiles_dimension),
+			                                &planes_spacing);
 
-	// Read head
-	if ((blob + sizeof(struct akoHead)) > (const uint8_t*)input + sizeof(struct akoHead))
-	{
-		status = AKO_BROKEN_INPUT;
-		goto return_failure;
+		if (compressed_size == 0 || compressed_size > (size_t)(input_end - blob))
+			return NULL;
+
+		blob += compressed_size;
 	}
 
-	if ((status = akoHeadRead(blob, &channels, &image_w, &image_h, &s)) != AKO_OK)
-		goto return_failure;
+	return blob;
+}
 
-	blob += sizeof(struct akoHead); // Update blob
 
-	// Allocate workareas and image
-	const size_t tiles_no = akoImageTilesNo(image_w, image_h, s.tiles_dimension);
-	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, s.tiles_dimension) +
-	                                akoImageMaxPlanesSpacingSize(image_w, image_h, s.tiles_dimension)) *
-	                               channels;
+static inline size_t sMin(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
 
-	workarea_a = checked_c.malloc(tile_total_size);
-	workarea_b = checked_c.malloc(tile_total_size);
 
-	if (workarea_a == NULL || workarea_b == NULL)
-	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
-	}
+static inline size_t sMax(size_t a, size_t b)
+{
+	return (a > b) ? a : b;
+}
 
-	if (tiles_no > 1) // Recycle
-	{
-		if ((image = checked_c.malloc(image_w * image_h * channels)) == NULL)
-		{
-			status = AKO_NO_ENOUGH_MEMORY;
-			goto return_failure;
-		}
-	}
-	else
+
+static inline size_t sScaledDimension(size_t d, size_t scale)
+{
+	return (d >> scale) + (((d & ((1 << scale) - 1)) != 0) ? 1 : 0);
+}
+
+
+static void sDownscale(size_t factor, size_t channels, size_t in_w, size_t in_h, size_t out_w, size_t out_h,
+                       size_t planes_stride, int16_t* inout)
+{
+	// Box filter, in place. What lifts couldn't reduce, either because the
+	// tile is too small to lift that many times, or there is no wavelet at all
+
+	for (size_t ch = 0; ch < channels; ch++)
 	{
-		if (s.wavelet != AKO_WAVELET_NONE)
-			image = workarea_a;
-		else
-			image = workarea_b;
+		int16_t* plane = inout + planes_stride * ch;
+
+		for (size_t row = 0; row < out_h; row++)
+			for (size_t col = 0; col < out_w; col++)
+			{
+				const size_t row_end = sMin(row * factor + factor, in_h);
+				const size_t col_end = sMin(col * factor + factor, in_w);
+				const int32_t n = (int32_t)((row_end - row * factor) * (col_end - col * factor));
+				int32_t sum = 0;
+
+				for (size_t r = row * factor; r < row_end; r++)
+					for (size_t c = col * factor; c < col_end; c++)
+						sum += plane[r * in_w + c];
+
+				// Round to nearest, halves away from zero
+				plane[row * out_w + col] = (int16_t)((sum >= 0) ? ((sum + n / 2) / n) : -((-sum + n / 2) / n));
+			}
 	}
+}
 
-	AKO_DEV_PRINTF("\nD\tTiles no: %zu, Tile total size: %zu\n", tiles_no, tile_total_size);
 
-	// Iterate tiles
-	size_t tile_x = 0;
-	size_t tile_y = 0;
+struct akoDecodeWorker
+{
+	const struct akoCallbacks* c;
+	const struct akoSettings* s;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+
+	size_t input_size;
+	const uint8_t* input;
+	const uint8_t* index;
+	const uint8_t* first_tile; // Where to start looking for our tiles
+	size_t first_tile_no;
+
+	size_t tiles_no;
+	size_t tiles_x; // Tiles per row
+	size_t scale;   // Output is 1/(2^scale) of the image dimensions
+
+	size_t region_x; // In pixels, of the output
+	size_t region_y;
+	size_t region_w;
+	size_t region_h;
+
+	size_t region_col; // In tiles, intersecting above region
+	size_t region_row;
+	size_t region_cols;
+
+	size_t job_start; // Contiguous range of tiles inside the region, in reading order
+	size_t job_end;
+
+	void* workarea_a;
+	void* workarea_b;
+
+	uint8_t* image; // Shared by all workers, tiles don't overlap
+	size_t image_pitch;  // In bytes, between pixels
+	size_t image_stride; // In bytes, between rows
+	const uint8_t* blob_end;
+	size_t blob_end_tile;
+	enum akoStatus status;
+};
+
 
-	size_t tile_data_size; // Size of data needed to operate per tile.
-	                       // Both encoder/decoder calculate this value just by reading the
-	                       // global header at the beginning. Any incongruence is an error.
+static void sDecodeTiles(struct akoDecodeWorker* w)
+{
+	const struct akoCallbacks* c = w->c;
+	const struct akoSettings* s = w->s;
 
-	size_t planes_spacing; // Space in order to follow the akoDividePlusOneRule()
-	                       // or: "memory between planes to use when needed".
-	                       // Spacing only lives here, at runtime, is not contained in the file.
-	                       // Saves us from extra mallocs() and helps with cache locality.
+	const uint8_t* blob = w->first_tile;
+	const uint8_t* input_end = w->input + w->input_size;
+	size_t blob_tile = w->first_tile_no; // Tile at which 'blob' points
 
-	for (size_t t = 0; t < tiles_no; t++)
+	for (size_t j = w->job_start; j < w->job_end; j++)
 	{
-		const size_t tile_w = akoTileDimension(tile_x, image_w, s.tiles_dimension);
-		const size_t tile_h = akoTileDimension(tile_y, image_h, s.tiles_dimension);
+		const size_t t = (w->region_row + j / w->region_cols) * w->tiles_x + w->region_col + j % w->region_cols;
 
-		if (s.wavelet != AKO_WAVELET_NONE)
-		{
-			tile_data_size = akoTileDataSize(tile_w, tile_h) * channels;
-			planes_spacing = akoPlanesSpacing(tile_w, tile_h);
-		}
-		else
-		{
-			tile_data_size = (tile_w * tile_h * channels * sizeof(int16_t));
-			planes_spacing = 0; // No DWT, no spacing needed
-		}
+		size_t tile_x;
+		size_t tile_y;
+		akoTilePosition(t, w->image_w, s->tiles_dimension, &tile_x, &tile_y);
+
+		const size_t tile_w = akoTileDimension(tile_x, w->image_w, s->tiles_dimension);
+		const size_t tile_h = akoTileDimension(tile_y, w->image_h, s->tiles_dimension);
+
+		size_t planes_spacing;
+		const size_t tile_data_size = sTileDataSize(s, w->channels, tile_w, tile_h, &planes_spacing);
+
+		// Scaling, lifts do most of the work (we just stop early), leaving the rest to a box filter
+		const size_t lifts = (s->wavelet != AKO_WAVELET_NONE) ? akoTileLiftsNo(tile_w, tile_h) : 0;
+		const size_t skip_lifts = sMin(w->scale, lifts);
+
+		const size_t prefix_size = (s->wavelet != AKO_WAVELET_NONE)
+		                               ? akoTileDataPrefixSize(tile_w, tile_h, skip_lifts) * w->channels
+		                               : tile_data_size;
 
 		// 1. Decompress
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, checked_c.events_data, checked_c.events);
+		sEvent(t, w->tiles_no, AKO_EVENT_COMPRESSION_START, c->events_data, c->events);
 		{
-			if (s.compression != AKO_COMPRESSION_NONE)
+			// Skip tiles outside the region
+			if (blob_tile != t && (blob = sLocateTile(s, w->channels, w->image_w, w->image_h, w->input_size,
+			                                          w->input, w->index, blob, blob_tile, t)) == NULL)
+			{
+				w->status = AKO_BROKEN_INPUT;
+				return;
+			}
+
+			// Index should agree with what we found reading sequentially
+			if (w->index != NULL && (size_t)(blob - w->input) != akoIndexRead(t, w->index))
+			{
+				w->status = AKO_BROKEN_INPUT;
+				return;
+			}
+
+			if (s->compression != AKO_COMPRESSION_NONE)
 			{
 				const size_t compressed_size =
-				    akoDecompress(s.compression, tile_data_size, tile_data_size + planes_spacing, blob, workarea_a);
+				    akoDecompress(s->compression, s->wavelet, w->channels, tile_w, tile_h, tile_data_size, prefix_size,
+				                  tile_data_size + planes_spacing, (size_t)(input_end - blob), blob, w->workarea_a);
 
 				if (compressed_size == 0)
 				{
-					status = AKO_BROKEN_INPUT;
-					goto return_failure;
+					w->status = AKO_BROKEN_INPUT;
+					return;
 				}
 
 				blob += compressed_size; // Update blob
@@ -160,67 +253,533 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 			else
 			{
 				// Check input
-				if ((blob + tile_data_size) > (const uint8_t*)input + input_size)
+				if ((blob + tile_data_size) > input_end)
 				{
-					status = AKO_BROKEN_INPUT;
-					goto return_failure;
+					w->status = AKO_BROKEN_INPUT;
+					return;
 				}
 
 				// Copy as is
-				for (size_t i = 0; i < tile_data_size; i++)
-					((uint8_t*)workarea_a)[i] = blob[i];
+				for (size_t i = 0; i < prefix_size; i++)
+					((uint8_t*)w->workarea_a)[i] = blob[i];
 
 				blob += tile_data_size; // Update blob
 			}
+
+			blob_tile = t + 1;
 		}
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, checked_c.events_data, checked_c.events);
+		sEvent(t, w->tiles_no, AKO_EVENT_COMPRESSION_END, c->events_data, c->events);
 
 		// 2. Wavelet transform
-		if (s.wavelet != AKO_WAVELET_NONE)
+		if (s->wavelet != AKO_WAVELET_NONE)
 		{
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, checked_c.events_data, checked_c.events);
-			akoUnlift(&s, channels, t, tile_w, tile_h, planes_spacing, workarea_a, workarea_b);
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, checked_c.events_data, checked_c.events);
+			sEvent(t, w->tiles_no, AKO_EVENT_WAVELET_START, c->events_data, c->events);
+			akoUnlift(s, w->channels, t, tile_w, tile_h, planes_spacing, skip_lifts, w->workarea_a, w->workarea_b);
+			sEvent(t, w->tiles_no, AKO_EVENT_WAVELET_END, c->events_data, c->events);
 		}
 
+		int16_t* from = (s->wavelet != AKO_WAVELET_NONE) ? w->workarea_b : w->workarea_a;
+		const size_t planes_stride = tile_w * tile_h + planes_spacing;
+
+		const size_t scaled_tile_x = tile_x >> w->scale;
+		const size_t scaled_tile_y = tile_y >> w->scale;
+		const size_t scaled_tile_w = sScaledDimension(tile_w, w->scale);
+		const size_t scaled_tile_h = sScaledDimension(tile_h, w->scale);
+
+		if (skip_lifts != w->scale)
+			sDownscale((size_t)1 << (w->scale - skip_lifts), w->channels, sScaledDimension(tile_w, skip_lifts),
+			           sScaledDimension(tile_h, skip_lifts), scaled_tile_w, scaled_tile_h, planes_stride, from);
+
 		// 3. Developers, developers, developers
 		// (before the format step destroys workarea a)
 		if (t < AKO_DEV_NOISE)
 		{
 			AKO_DEV_PRINTF(
 			    "D\tTile %zu at %zu:%zu, %zux%zu px, planes spacing: %zu, size: %zu bytes, cursor: %zu bytes\n", t,
-			    tile_x, tile_y, tile_w, tile_h, planes_spacing, tile_data_size, (size_t)(blob - (const uint8_t*)input));
+			    tile_x, tile_y, tile_w, tile_h, planes_spacing, tile_data_size, (size_t)(blob - w->input));
 		}
 		else if (t == AKO_DEV_NOISE + 1)
 		{
 			AKO_DEV_PRINTF("D\t...\n");
 		}
 
-		// 4. Format
+		// 4. Format, just the part inside the region
 		{
-			sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, checked_c.events_data, checked_c.events);
+			sEvent(t, w->tiles_no, AKO_EVENT_FORMAT_START, c->events_data, c->events);
+
+			const size_t x = sMax(scaled_tile_x, w->region_x);
+			const size_t y = sMax(scaled_tile_y, w->region_y);
+			const size_t x_end = sMin(scaled_tile_x + scaled_tile_w, w->region_x + w->region_w);
+			const size_t y_end = sMin(scaled_tile_y + scaled_tile_h, w->region_y + w->region_h);
+
+			akoFormatToInterleavedU8Rgb(s->color, w->channels, scaled_tile_w, scaled_tile_h,
+			                            planes_stride - scaled_tile_w * scaled_tile_h, x - scaled_tile_x,
+			                            y - scaled_tile_y, x_end - x, y_end - y, w->image_pitch, w->image_stride, from,
+			                            w->image + w->image_stride * (y - w->region_y) +
+			                                w->image_pitch * (x - w->region_x));
+
+			sEvent(t, w->tiles_no, AKO_EVENT_FORMAT_END, c->events_data, c->events);
+		}
+	}
+
+	w->blob_end = blob;
+	w->blob_end_tile = blob_tile;
+	w->status = AKO_OK;
+}
+
+
+static void sDecodeWorker(size_t worker_no, void* raw_workers)
+{
+	struct akoDecodeWorker* workers = raw_workers;
+	sDecodeTiles(&workers[worker_no]);
+}
+
+
+//
+
+
+struct akoDecodeContext
+{
+	struct akoCallbacks c;
+
+	size_t workers_no; // Allocated ones, an image may use less
+	struct akoDecodeWorker* workers;
+	size_t workareas_size; // Of each workarea
+};
+
+
+static enum akoStatus sContextInit(struct akoDecodeContext* ctx, const struct akoCallbacks* c)
+{
+	ctx->c = (c != NULL) ? *c : akoDefaultCallbacks();
+	ctx->workers_no = 0;
+	ctx->workers = NULL;
+	ctx->workareas_size = 0;
+
+	if (ctx->c.malloc == NULL || ctx->c.realloc == NULL || ctx->c.free == NULL)
+		return AKO_INVALID_CALLBACKS;
 
-			int16_t* from = (s.wavelet != AKO_WAVELET_NONE) ? workarea_b : workarea_a;
-			akoFormatToInterleavedU8Rgb(s.color, channels, tile_w, tile_h, planes_spacing, image_w, from,
-			                            image + (image_w * tile_y + tile_x) * channels);
+	return AKO_OK;
+}
+
+
+static void sContextRelease(struct akoDecodeContext* ctx)
+{
+	for (size_t i = 0; i < ctx->workers_no; i++)
+	{
+		if (ctx->workers[i].workarea_a != NULL)
+			ctx->c.free(ctx->workers[i].workarea_a);
+		if (ctx->workers[i].workarea_b != NULL)
+			ctx->c.free(ctx->workers[i].workarea_b);
+	}
+
+	if (ctx->workers != NULL)
+		ctx->c.free(ctx->workers);
+
+	ctx->workers_no = 0;
+	ctx->workers = NULL;
+	ctx->workareas_size = 0;
+}
+
+
+struct akoDecoder
+{
+	struct akoCallbacks c;
+	struct akoSettings s;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+
+	size_t input_size;
+	const uint8_t* input;
+	const uint8_t* index;
+	const uint8_t* first_tile;
+
+	const uint8_t* cursor; // Where tile 'cursor_tile' begins, as far as we
+	size_t cursor_tile;    // know from previous runs
+
+	size_t tiles_no;
+	size_t tiles_x; // Tiles per row
+	size_t scale;
+	size_t scaled_w;
+	size_t scaled_h;
+
+	struct akoDecodeContext* ctx;
+	size_t workers_no; // In use, from the context ones
+	struct akoDecodeWorker* workers;
+};
+
+
+static enum akoStatus sDecoderBegin(struct akoDecoder* d, struct akoDecodeContext* ctx, size_t input_size,
+                                    const void* input, size_t scale)
+{
+	enum akoStatus status;
+	const uint8_t* blob = input;
+
+	d->c = ctx->c;
+	d->ctx = ctx;
+	d->workers_no = 0;
+	d->workers = NULL;
+
+	// Check input
+	if (input == NULL)
+		return AKO_INVALID_INPUT;
+
+	// Read head
+	if ((blob + sizeof(struct akoHead)) > (const uint8_t*)input + input_size)
+		return AKO_BROKEN_INPUT;
 
-			sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, checked_c.events_data, checked_c.events);
+	if ((status = akoHeadRead(blob, &d->channels, &d->image_w, &d->image_h, &d->s)) != AKO_OK)
+		return status;
+
+	blob += sizeof(struct akoHead); // Update blob
+
+	// Check scale
+	if (scale > AKO_MAX_SCALE)
+		return AKO_INVALID_SCALE;
+
+	d->scale = scale;
+	d->scaled_w = sScaledDimension(d->image_w, scale);
+	d->scaled_h = sScaledDimension(d->image_h, scale);
+
+	// Read index (if any)
+	d->tiles_no = akoImageTilesNo(d->image_w, d->image_h, d->s.tiles_dimension);
+	d->tiles_x = (d->s.tiles_dimension != 0)
+	                 ? (d->image_w / d->s.tiles_dimension + ((d->image_w % d->s.tiles_dimension != 0) ? 1 : 0))
+	                 : 1;
+	d->index = NULL;
+
+	if (d->s.tiles_index != 0)
+	{
+		if ((blob + akoIndexSize(d->tiles_no)) > (const uint8_t*)input + input_size)
+			return AKO_BROKEN_INPUT;
+
+		d->index = blob;
+		blob += akoIndexSize(d->tiles_no); // Update blob
+	}
+
+	// Bye!
+	d->input_size = input_size;
+	d->input = input;
+	d->first_tile = blob;
+	d->cursor = blob;
+	d->cursor_tile = 0;
+
+	return AKO_OK;
+}
+
+
+static enum akoStatus sDecoderWorkers(struct akoDecoder* d, size_t jobs_no)
+{
+	// Each worker with its own workareas, these, and workers, only grow. Once a
+	// context decoded the biggest image it will see, following ones are free
+	struct akoDecodeContext* ctx = d->ctx;
+
+	const size_t tile_total_size = (akoImageMaxTileDataSize(d->image_w, d->image_h, d->s.tiles_dimension) +
+	                                akoImageMaxPlanesSpacingSize(d->image_w, d->image_h, d->s.tiles_dimension)) *
+	                               d->channels;
+
+	const size_t workers_no = akoThreadsNo(d->c.threads, jobs_no);
+
+	if (workers_no > ctx->workers_no)
+	{
+		struct akoDecodeWorker* workers =
+		    ctx->c.realloc(ctx->workers, sizeof(struct akoDecodeWorker) * workers_no);
+
+		if (workers == NULL)
+			return AKO_NO_ENOUGH_MEMORY;
+
+		for (size_t i = ctx->workers_no; i < workers_no; i++)
+		{
+			workers[i].workarea_a = NULL;
+			workers[i].workarea_b = NULL;
 		}
 
-		// 5. Next tile
-		tile_x += s.tiles_dimension;
-		if (tile_x >= image_w)
+		ctx->workers = workers;
+		ctx->workers_no = workers_no;
+	}
+
+	if (tile_total_size > ctx->workareas_size)
+	{
+		for (size_t i = 0; i < ctx->workers_no; i++)
 		{
-			tile_x = 0;
-			tile_y += s.tiles_dimension;
+			if (ctx->workers[i].workarea_a != NULL)
+				ctx->c.free(ctx->workers[i].workarea_a);
+			if (ctx->workers[i].workarea_b != NULL)
+				ctx->c.free(ctx->workers[i].workarea_b);
+
+			ctx->workers[i].workarea_a = NULL;
+			ctx->workers[i].workarea_b = NULL;
 		}
+
+		ctx->workareas_size = tile_total_size;
 	}
 
-	// Bye!
-	if (workarea_a != image)
-		checked_c.free(workarea_a);
-	if (workarea_b != image)
-		checked_c.free(workarea_b);
+	d->workers = ctx->workers;
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		struct akoDecodeWorker* w = &d->workers[i];
+		d->workers_no = i + 1;
+
+		w->c = &d->c;
+		w->s = &d->s;
+		w->channels = d->channels;
+		w->image_w = d->image_w;
+		w->image_h = d->image_h;
+
+		w->input_size = d->input_size;
+		w->input = d->input;
+		w->index = d->index;
+
+		w->tiles_no = d->tiles_no;
+		w->tiles_x = d->tiles_x;
+		w->scale = d->scale;
+
+		if (w->workarea_a == NULL)
+			w->workarea_a = ctx->c.malloc(ctx->workareas_size);
+		if (w->workarea_b == NULL)
+			w->workarea_b = ctx->c.malloc(ctx->workareas_size);
+
+		if (w->workarea_a == NULL || w->workarea_b == NULL)
+			return AKO_NO_ENOUGH_MEMORY;
+	}
+
+	AKO_DEV_PRINTF("\nD\tTiles no: %zu, Tile total size: %zu, Workers: %zu\n", d->tiles_no, tile_total_size,
+	               workers_no);
+
+	return AKO_OK;
+}
+
+
+static size_t sDecoderRegionTiles(const struct akoDecoder* d, size_t region_x, size_t region_y, size_t region_w,
+                                  size_t region_h, size_t* out_col, size_t* out_row, size_t* out_cols)
+{
+	// Tiles dimension is always divisible by the scale
+	const size_t tiles_d =
+	    (d->s.tiles_dimension != 0) ? (d->s.tiles_dimension >> d->scale) : sMax(d->scaled_w, d->scaled_h);
+
+	const size_t col = region_x / tiles_d;
+	const size_t row = region_y / tiles_d;
+	const size_t cols = (region_x + region_w - 1) / tiles_d - col + 1;
+	const size_t rows = (region_y + region_h - 1) / tiles_d - row + 1;
+
+	if (out_col != NULL)
+		*out_col = col;
+	if (out_row != NULL)
+		*out_row = row;
+	if (out_cols != NULL)
+		*out_cols = cols;
+
+	return cols * rows;
+}
+
+
+static enum akoStatus sDecoderRun(struct akoDecoder* d, size_t region_x, size_t region_y, size_t region_w,
+                                  size_t region_h, size_t image_pitch, size_t image_stride, uint8_t* image)
+{
+	size_t col;
+	size_t row;
+	size_t cols;
+	const size_t jobs_no = sDecoderRegionTiles(d, region_x, region_y, region_w, region_h, &col, &row, &cols);
+	const size_t workers_no = (d->workers_no < jobs_no) ? d->workers_no : jobs_no;
+
+	// Start looking for tiles from the cursor, unless
+	// the region begins before (then from the first one)
+	if (row * d->tiles_x + col < d->cursor_tile)
+	{
+		d->cursor = d->first_tile;
+		d->cursor_tile = 0;
+	}
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		struct akoDecodeWorker* w = &d->workers[i];
+
+		w->first_tile = d->cursor;
+		w->first_tile_no = d->cursor_tile;
+
+		w->region_x = region_x;
+		w->region_y = region_y;
+		w->region_w = region_w;
+		w->region_h = region_h;
+
+		w->region_col = col;
+		w->region_row = row;
+		w->region_cols = cols;
+
+		w->job_start = (jobs_no * (i + 0)) / workers_no;
+		w->job_end = (jobs_no * (i + 1)) / workers_no;
+
+		w->image = image;
+		w->image_pitch = image_pitch;
+		w->image_stride = image_stride;
+		w->status = AKO_ERROR;
+	}
+
+	// Iterate tiles
+	if (workers_no == 1)
+		sDecodeTiles(&d->workers[0]);
+	else
+		akoThreadsRun(workers_no, sDecodeWorker, d->workers);
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		if (d->workers[i].status != AKO_OK)
+			return d->workers[i].status;
+	}
+
+	// Last worker knows where following tiles begin
+	d->cursor = d->workers[workers_no - 1].blob_end;
+	d->cursor_tile = d->workers[workers_no - 1].blob_end_tile;
+
+	return AKO_OK;
+}
+
+
+static uint8_t* sDecode(const struct akoCallbacks* c, size_t input_size, const void* input, size_t scale,
+                        int whole_image, size_t region_x, size_t region_y, size_t region_w, size_t region_h,
+                        struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                        enum akoStatus* out_status)
+{
+	struct akoDecodeContext ctx;
+	struct akoDecoder d;
+	enum akoStatus status;
+	uint8_t* image = NULL;
+
+	if ((status = sContextInit(&ctx, c)) != AKO_OK)
+		goto return_failure;
+
+	if ((status = sDecoderBegin(&d, &ctx, input_size, input, scale)) != AKO_OK)
+		goto return_failure;
+
+	// Check region (in scaled dimensions)
+	if (whole_image != 0)
+	{
+		region_x = 0;
+		region_y = 0;
+		region_w = d.scaled_w;
+		region_h = d.scaled_h;
+	}
+	else if (region_w == 0 || region_h == 0 || region_x >= d.scaled_w || region_y >= d.scaled_h ||
+	         region_w > d.scaled_w - region_x || region_h > d.scaled_h - region_y)
+	{
+		status = AKO_INVALID_REGION;
+		goto return_failure;
+	}
+
+	// Allocate workers and image
+	const size_t jobs_no = sDecoderRegionTiles(&d, region_x, region_y, region_w, region_h, NULL, NULL, NULL);
+
+	if ((status = sDecoderWorkers(&d, jobs_no)) != AKO_OK)
+		goto return_failure;
+
+	if (jobs_no > 1) // Recycle
+	{
+		if ((image = d.c.malloc(region_w * region_h * d.channels)) == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
+	else
+	{
+		if (d.s.wavelet != AKO_WAVELET_NONE)
+			image = d.workers[0].workarea_a;
+		else
+			image = d.workers[0].workarea_b;
+	}
+
+	// Decode
+	if ((status = sDecoderRun(&d, region_x, region_y, region_w, region_h, d.channels, region_w * d.channels,
+	                          image)) != AKO_OK)
+		goto return_failure;
+
+	// Bye! (a recycled workarea is no longer from the context)
+	if (ctx.workers[0].workarea_a == image)
+		ctx.workers[0].workarea_a = NULL;
+	if (ctx.workers[0].workarea_b == image)
+		ctx.workers[0].workarea_b = NULL;
+
+	sContextRelease(&ctx);
+
+	if (out_s != NULL)
+		*out_s = d.s;
+	if (out_channels != NULL)
+		*out_channels = d.channels;
+	if (out_w != NULL)
+		*out_w = d.image_w;
+	if (out_h != NULL)
+		*out_h = d.image_h;
+
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return image;
+
+return_failure:
+	if (image != NULL && image != ctx.workers[0].workarea_a && image != ctx.workers[0].workarea_b)
+		ctx.c.free(image);
+
+	sContextRelease(&ctx);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return NULL;
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                 struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                                 enum akoStatus* out_status)
+{
+	return sDecode(c, input_size, input, 0, 1, 0, 0, 0, 0, out_s, out_channels, out_w, out_h, out_status);
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeRegion(const struct akoCallbacks* c, size_t input_size, const void* input, size_t x,
+                                   size_t y, size_t w, size_t h, struct akoSettings* out_s, size_t* out_channels,
+                                   size_t* out_image_w, size_t* out_image_h, enum akoStatus* out_status)
+{
+	return sDecode(c, input_size, input, 0, 0, x, y, w, h, out_s, out_channels, out_image_w, out_image_h, out_status);
+}
+
+
+AKO_EXPORT uint8_t* akoDecodeScaled(const struct akoCallbacks* c, size_t input_size, const void* input, size_t scale,
+                                   struct akoSettings* out_s, size_t* out_channels, size_t* out_w, size_t* out_h,
+                                   enum akoStatus* out_status)
+{
+	size_t image_w;
+	size_t image_h;
+	uint8_t* image = sDecode(c, input_size, input, scale, 1, 0, 0, 0, 0, out_s, out_channels, &image_w, &image_h,
+	                         out_status);
+
+	if (image != NULL && out_w != NULL)
+		*out_w = sScaledDimension(image_w, scale);
+	if (image != NULL && out_h != NULL)
+		*out_h = sScaledDimension(image_h, scale);
+
+	return image;
+}
+
+
+AKO_EXPORT enum akoStatus akoDecodeHead(size_t input_size, const void* input, struct akoSettings* out_s,
+                                        size_t* out_channels, size_t* out_w, size_t* out_h)
+{
+	struct akoSettings s;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+	enum akoStatus status;
+
+	if (input == NULL)
+		return AKO_INVALID_INPUT;
+
+	if (input_size < sizeof(struct akoHead))
+		return AKO_BROKEN_INPUT;
+
+	if ((status = akoHeadRead(input, &channels, &image_w, &image_h, &s)) != AKO_OK)
+		return status;
 
 	if (out_s != NULL)
 		*out_s = s;
@@ -231,20 +790,182 @@ AKO_EXPORT uint8_t* akoDecodeExt(const struct akoCallbacks* c, size_t input_size
 	if (out_h != NULL)
 		*out_h = image_h;
 
+	return AKO_OK;
+}
+
+
+static enum akoStatus sDecodeInto(struct akoDecodeContext* ctx, size_t input_size, const void* input,
+                                  size_t dst_pitch, size_t dst_stride, void* dst, struct akoSettings* out_s,
+                                  size_t* out_channels, size_t* out_w, size_t* out_h)
+{
+	struct akoDecoder d;
+	enum akoStatus status;
+
+	if ((status = sDecoderBegin(&d, ctx, input_size, input, 0)) != AKO_OK)
+		return status;
+
+	// Check destination, zeros meaning tightly packed
+	dst_pitch = (dst_pitch != 0) ? dst_pitch : d.channels;
+	dst_stride = (dst_stride != 0) ? dst_stride : (d.image_w * dst_pitch);
+
+	if (dst == NULL || dst_pitch < d.channels || dst_stride < d.image_w * dst_pitch)
+		return AKO_INVALID_INPUT;
+
+	// Workers, no image as we have one
+	if ((status = sDecoderWorkers(&d, d.tiles_no)) != AKO_OK)
+		return status;
+
+	// Decode
+	if ((status = sDecoderRun(&d, 0, 0, d.image_w, d.image_h, dst_pitch, dst_stride, dst)) != AKO_OK)
+		return status;
+
+	// Bye!
+	if (out_s != NULL)
+		*out_s = d.s;
+	if (out_channels != NULL)
+		*out_channels = d.channels;
+	if (out_w != NULL)
+		*out_w = d.image_w;
+	if (out_h != NULL)
+		*out_h = d.image_h;
+
+	return AKO_OK;
+}
+
+
+AKO_EXPORT enum akoStatus akoDecodeInto(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                        size_t dst_pitch, size_t dst_stride, void* dst, struct akoSettings* out_s,
+                                        size_t* out_channels, size_t* out_w, size_t* out_h)
+{
+	struct akoDecodeContext ctx;
+	enum akoStatus status;
+
+	// A context just for this image
+	if ((status = sContextInit(&ctx, c)) == AKO_OK)
+		status = sDecodeInto(&ctx, input_size, input, dst_pitch, dst_stride, dst, out_s, out_channels, out_w, out_h);
+
+	sContextRelease(&ctx);
+	return status;
+}
+
+
+AKO_EXPORT struct akoDecodeContext* akoDecodeContextCreate(const struct akoCallbacks* c, enum akoStatus* out_status)
+{
+	struct akoDecodeContext temp;
+	struct akoDecodeContext* ctx;
+	enum akoStatus status;
+
+	if ((status = sContextInit(&temp, c)) != AKO_OK)
+		goto return_failure;
+
+	if ((ctx = temp.c.malloc(sizeof(struct akoDecodeContext))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	*ctx = temp;
+
 	if (out_status != NULL)
 		*out_status = AKO_OK;
 
-	return image;
+	return ctx;
 
 return_failure:
-	if (image != workarea_a && image != workarea_b)
-		checked_c.free(image);
-	if (workarea_a != NULL)
-		checked_c.free(workarea_a);
-	if (workarea_b != NULL)
-		checked_c.free(workarea_b);
 	if (out_status != NULL)
 		*out_status = status;
 
 	return NULL;
 }
+
+
+AKO_EXPORT void akoDecodeContextDelete(struct akoDecodeContext* ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	sContextRelease(ctx);
+	ctx->c.free(ctx);
+}
+
+
+AKO_EXPORT enum akoStatus akoDecodeWithContext(struct akoDecodeContext* ctx, size_t input_size, const void* input,
+                                               size_t dst_pitch, size_t dst_stride, void* dst,
+                                               struct akoSettings* out_s, size_t* out_channels, size_t* out_w,
+                                               size_t* out_h)
+{
+	if (ctx == NULL)
+		return AKO_INVALID_INPUT;
+
+	return sDecodeInto(ctx, input_size, input, dst_pitch, dst_stride, dst, out_s, out_channels, out_w, out_h);
+}
+
+
+AKO_EXPORT enum akoStatus akoDecodeRows(const struct akoCallbacks* c, size_t input_size, const void* input,
+                                        void (*rows)(size_t row, size_t rows_no, size_t stride, const uint8_t* data,
+                                                     void* user_data),
+                                        void* rows_data, struct akoSettings* out_s, size_t* out_channels,
+                                        size_t* out_w, size_t* out_h)
+{
+	struct akoDecodeContext ctx;
+	struct akoDecoder d;
+	enum akoStatus status;
+	uint8_t* band = NULL;
+
+	if ((status = sContextInit(&ctx, c)) != AKO_OK)
+		goto return_failure;
+
+	if ((status = sDecoderBegin(&d, &ctx, input_size, input, 0)) != AKO_OK)
+		goto return_failure;
+
+	if (rows == NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	// Allocate workers and band, these only need to handle a row of tiles
+	const size_t band_h = akoTileDimension(0, d.image_h, d.s.tiles_dimension);
+
+	if ((status = sDecoderWorkers(&d, d.tiles_x)) != AKO_OK)
+		goto return_failure;
+
+	if ((band = d.c.malloc(d.image_w * band_h * d.channels)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Decode, one band at time
+	for (size_t y = 0; y < d.image_h; y += band_h)
+	{
+		const size_t h = akoTileDimension(y, d.image_h, d.s.tiles_dimension);
+
+		if ((status = sDecoderRun(&d, 0, y, d.image_w, h, d.channels, d.image_w * d.channels, band)) != AKO_OK)
+			goto return_failure;
+
+		rows(y, h, d.image_w * d.channels, band, rows_data);
+	}
+
+	// Bye!
+	ctx.c.free(band);
+	sContextRelease(&ctx);
+
+	if (out_s != NULL)
+		*out_s = d.s;
+	if (out_channels != NULL)
+		*out_channels = d.channels;
+	if (out_w != NULL)
+		*out_w = d.image_w;
+	if (out_h != NULL)
+		*out_h = d.image_h;
+
+	return AKO_OK;
+
+return_failure:
+	if (band != NULL)
+		ctx.c.free(band);
+
+	sContextRelease(&ctx);
+	return status;
+}
@@ -35,198 +35,1078 @@ static inline void sEvent(size_t tile_no, size_t total_tiles, enum akoEvent even
 }
 
 
-AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
-                               size_t image_w, size_t image_h, const void* in, void** out, enum akoStatus* out_status)
+static size_t sTileDataSize(const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
+                            size_t* out_planes_spacing)
 {
-	enum akoStatus status;
-
-	size_t blob_size = 0;
-	uint8_t* blob = NULL;
+	// Size of data needed to operate per tile.
+	// Both encoder/decoder calculate this value just by reading the
+	// global header at the beginning. Any incongruence is an error.
 
-	void* workarea_a = NULL;
-	void* workarea_b = NULL;
+	// Planes spacing is the space in order to follow the akoDividePlusOneRule()
+	// or: "memory between planes to use when needed".
+	// Spacing only lives here, at runtime, is not contained in the file.
+	// Saves us from extra mallocs() and helps with cache locality.
 
-	// Check callbacks, settings and input
-	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
-	struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+	// It's also the most that a compressed tile can occupy, as
+	// compression fails rather than making things bigger.
 
-	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	if (s->wavelet != AKO_WAVELET_NONE)
 	{
-		status = AKO_INVALID_CALLBACKS;
-		goto return_failure;
+		*out_planes_spacing = akoPlanesSpacing(tile_w, tile_h);
+		return akoTileDataSize(tile_w, tile_h) * channels;
 	}
 
-	{
-		if (checked_s.color == AKO_COLOR_YCOCG && (checked_s.quantization > 0 || checked_s.gate > 0))
-			checked_s.color = AKO_COLOR_YCOCG_Q;
-		else if (checked_s.color == AKO_COLOR_YCOCG_Q && (checked_s.quantization <= 0 && checked_s.gate <= 0))
-			checked_s.color = AKO_COLOR_YCOCG;
-	}
+	*out_planes_spacing = 0; // No DWT, no spacing needed
+	return (tile_w * tile_h * channels * sizeof(int16_t));
+}
 
-	if (in == NULL)
-	{
-		status = AKO_INVALID_INPUT;
-		goto return_failure;
-	}
 
-	// Allocate blob
-	blob_size = sizeof(struct akoHead);
+static size_t sTilesBound(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h,
+                          size_t tile_start, size_t tile_end)
+{
+	size_t bound = 0;
 
-	if ((blob = checked_c.malloc(blob_size)) == NULL)
+	for (size_t t = tile_start; t < tile_end; t++)
 	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
+		size_t tile_x;
+		size_t tile_y;
+		size_t planes_spacing;
+		akoTilePosition(t, image_w, s->tiles_dimension, &tile_x, &tile_y);
+
+		bound += sTileDataSize(s, channels, akoTileDimension(tile_x, image_w, s->tiles_dimension),
+		                       akoTileDimension(tile_y, image_h, s->tiles_dimension), &planes_spacing);
 	}
 
-	// Write head
-	if ((status = akoHeadWrite(channels, image_w, image_h, &checked_s, blob)) != AKO_OK)
-		goto return_failure;
+	return bound;
+}
 
-	// Allocate workareas
-	const size_t tiles_no = akoImageTilesNo(image_w, image_h, checked_s.tiles_dimension);
-	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, checked_s.tiles_dimension) +
-	                                akoImageMaxPlanesSpacingSize(image_w, image_h, checked_s.tiles_dimension)) *
-	                               channels;
 
-	workarea_a = checked_c.malloc(tile_total_size);
-	workarea_b = checked_c.malloc(tile_total_size);
+struct akoEncodeWorker
+{
+	const struct akoCallbacks* c;
+	const struct akoSettings* s;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+	const void* in;
+	size_t in_row;    // Image row at which 'in' begins
+	size_t in_stride; // In bytes
 
-	if (workarea_a == NULL || workarea_b == NULL)
-	{
-		status = AKO_NO_ENOUGH_MEMORY;
-		goto return_failure;
-	}
+	size_t tiles_no;
+	size_t tile_start; // Contiguous range of tiles, this way concatenating
+	size_t tile_end;   // workers outputs, in order, gives us the final output
 
-	AKO_DEV_PRINTF("\nE\tTiles no: %zu, Tile total size: %zu\n", tiles_no, tile_total_size);
+	void* workarea_a;
+	void* workarea_b;
+	void* workarea_c; // Only with Manbavaran, to let it and Kagari compete without encoding twice
 
-	// Iterate tiles
-	size_t tile_x = 0;
-	size_t tile_y = 0;
+	struct akoQuantizationTable quantization[4]; // Edge tiles make at most four shapes
 
-	size_t tile_data_size; // Size of data needed to operate per tile.
-	                       // Both encoder/decoder calculate this value just by reading the
-	                       // global header at the beginning. Any incongruence is an error.
+	size_t* tiles_size; // Shared by all workers, NULL if there is no index to write
 
-	size_t planes_spacing; // Space in order to follow the akoDividePlusOneRule()
-	                       // or: "memory between planes to use when needed".
-	                       // Spacing only lives here, at runtime, is not contained in the file.
-	                       // Saves us from extra mallocs() and helps with cache locality.
+	uint8_t* out; // Tiles are compressed here, directly, unless 'grow' is set
+	size_t out_size;
+	size_t out_used;
+	int grow; // Output allocated by the worker, growing as tiles need it
+	enum akoStatus status;
+};
+
+
+static const struct akoQuantizationTable* sQuantizationTable(struct akoEncodeWorker* w, size_t tile_w, size_t tile_h)
+{
+	struct akoQuantizationTable* table = &w->quantization[0];
 
-	for (size_t t = 0; t < tiles_no; t++)
+	for (size_t i = 0; i < 4; i++)
 	{
-		const size_t tile_w = akoTileDimension(tile_x, image_w, checked_s.tiles_dimension);
-		const size_t tile_h = akoTileDimension(tile_y, image_h, checked_s.tiles_dimension);
+		if (w->quantization[i].tile_w == tile_w && w->quantization[i].tile_h == tile_h)
+			return &w->quantization[i];
 
-		if (checked_s.wavelet != AKO_WAVELET_NONE)
+		if (w->quantization[i].tile_w == 0) // First time we see this shape
 		{
-			tile_data_size = akoTileDataSize(tile_w, tile_h) * channels;
-			planes_spacing = akoPlanesSpacing(tile_w, tile_h);
-		}
-		else
-		{
-			tile_data_size = (tile_w * tile_h * channels * sizeof(int16_t));
-			planes_spacing = 0; // No DWT, no spacing needed
+			table = &w->quantization[i];
+			break;
 		}
+	}
+
+	akoQuantizationTable(w->s, tile_w, tile_h, table);
+	return table;
+}
+
+
+static int sWorkerGrow(struct akoEncodeWorker* w, size_t needed)
+{
+	if (needed <= w->out_size)
+		return 1;
+
+	// By half at least, to not reallocate on every tile
+	size_t new_size = w->out_size + w->out_size / 2;
+	if (new_size < needed)
+		new_size = needed;
+
+	uint8_t* out = (w->out != NULL) ? w->c->realloc(w->out, new_size) : w->c->malloc(new_size);
+	if (out == NULL)
+		return 0;
+
+	w->out = out;
+	w->out_size = new_size;
+	return 1;
+}
+
+
+static void sEncodeTiles(struct akoEncodeWorker* w)
+{
+	const struct akoCallbacks* c = w->c;
+	const struct akoSettings* s = w->s;
+
+	for (size_t t = w->tile_start; t < w->tile_end; t++)
+	{
+		size_t tile_x;
+		size_t tile_y;
+		akoTilePosition(t, w->image_w, s->tiles_dimension, &tile_x, &tile_y);
+
+		const size_t tile_w = akoTileDimension(tile_x, w->image_w, s->tiles_dimension);
+		const size_t tile_h = akoTileDimension(tile_y, w->image_h, s->tiles_dimension);
+
+		size_t planes_spacing;
+		const size_t tile_data_size = sTileDataSize(s, w->channels, tile_w, tile_h, &planes_spacing);
 
 		// 1. Format
-		sEvent(t, tiles_no, AKO_EVENT_FORMAT_START, checked_c.events_data, checked_c.events);
+		sEvent(t, w->tiles_no, AKO_EVENT_FORMAT_START, c->events_data, c->events);
 		{
-			akoFormatToPlanarI16Yuv(checked_s.discard_non_visible, checked_s.color, channels, tile_w, tile_h, image_w,
-			                        planes_spacing, (const uint8_t*)in + ((image_w * tile_y) + tile_x) * channels,
-			                        workarea_a);
+			akoFormatToPlanarI16Yuv(s->discard_non_visible, s->color, w->channels, tile_w, tile_h, w->in_stride,
+			                        planes_spacing,
+			                        (const uint8_t*)w->in + w->in_stride * (tile_y - w->in_row) + tile_x * w->channels,
+			                        w->workarea_a);
 		}
-		sEvent(t, tiles_no, AKO_EVENT_FORMAT_END, checked_c.events_data, checked_c.events);
+		sEvent(t, w->tiles_no, AKO_EVENT_FORMAT_END, c->events_data, c->events);
 
 		// 2. Wavelet transform
-		if (checked_s.wavelet != AKO_WAVELET_NONE)
+		if (s->wavelet != AKO_WAVELET_NONE)
 		{
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_START, checked_c.events_data, checked_c.events);
-			akoLift(t, &checked_s, channels, tile_w, tile_h, planes_spacing, workarea_a, workarea_b);
-			sEvent(t, tiles_no, AKO_EVENT_WAVELET_END, checked_c.events_data, checked_c.events);
+			sEvent(t, w->tiles_no, AKO_EVENT_WAVELET_START, c->events_data, c->events);
+			akoLift(t, s, sQuantizationTable(w, tile_w, tile_h), w->channels, tile_w, tile_h, planes_spacing,
+			        w->workarea_a, w->workarea_b);
+			sEvent(t, w->tiles_no, AKO_EVENT_WAVELET_END, c->events_data, c->events);
 		}
 
-		// 3. Compress
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_START, checked_c.events_data, checked_c.events);
+		// 3. Compress, straight into the output. Unless it grows, then into the workarea
+		// not in use and copied from there, so the output doesn't need to hold the worst case
+		sEvent(t, w->tiles_no, AKO_EVENT_COMPRESSION_START, c->events_data, c->events);
 		{
-			uint8_t* from = (checked_s.wavelet != AKO_WAVELET_NONE) ? ((uint8_t*)workarea_b) : ((uint8_t*)workarea_a);
+			const uint8_t* from =
+			    (s->wavelet != AKO_WAVELET_NONE) ? ((uint8_t*)w->workarea_b) : ((uint8_t*)w->workarea_a);
+
+			uint8_t* to = w->out + w->out_used;
+			size_t to_size = w->out_size - w->out_used;
 			size_t compressed_size = tile_data_size;
 
-			// Compress, or not
-			if (checked_s.compression != AKO_COMPRESSION_NONE)
+			if (w->grow != 0)
 			{
-				void* to = (checked_s.wavelet != AKO_WAVELET_NONE) ? workarea_a : workarea_b;
+				to = (s->wavelet != AKO_WAVELET_NONE) ? ((uint8_t*)w->workarea_a) : ((uint8_t*)w->workarea_b);
+				to_size = tile_data_size;
+			}
 
-				if ((compressed_size =
-				         akoCompress(checked_s.compression, channels, tile_w, tile_h, (coeff_t*)from, to)) == 0)
+			if (s->compression != AKO_COMPRESSION_NONE)
+			{
+				if ((compressed_size = akoCompress(s->compression, s->wavelet, w->channels, tile_w, tile_h,
+				                                   tile_data_size, to_size, (coeff_t*)from, to, w->workarea_c)) == 0)
+				{
+					// Either incompressible, or there was no space to begin with
+					w->status = (to_size < tile_data_size) ? AKO_NO_ENOUGH_MEMORY : AKO_ERROR;
+					return;
+				}
+			}
+			else
+			{
+				if (to_size < tile_data_size)
 				{
-					status = AKO_ERROR;
-					goto return_failure;
+					w->status = AKO_NO_ENOUGH_MEMORY;
+					return;
 				}
 
-				from = to;
+				// Copy as is
+				for (size_t i = 0; i < tile_data_size; i++)
+					to[i] = from[i];
 			}
 
-			// Make space
-			void* updated_blob = checked_c.realloc(blob, blob_size + compressed_size);
-			if (updated_blob == NULL)
+			if (w->grow != 0)
 			{
-				status = AKO_NO_ENOUGH_MEMORY;
-				goto return_failure;
+				if (sWorkerGrow(w, w->out_used + compressed_size) == 0)
+				{
+					w->status = AKO_NO_ENOUGH_MEMORY;
+					return;
+				}
+
+				__builtin_memcpy(w->out + w->out_used, to, compressed_size);
 			}
 
-			// Copy as is
-			blob = updated_blob;
-			for (size_t i = 0; i < compressed_size; i++)
-				blob[blob_size + i] = from[i];
+			w->out_used += compressed_size; // Update output
 
-			blob_size += compressed_size; // Update blob
+			if (w->tiles_size != NULL)
+				w->tiles_size[t] = compressed_size;
 		}
-		sEvent(t, tiles_no, AKO_EVENT_COMPRESSION_END, checked_c.events_data, checked_c.events);
+		sEvent(t, w->tiles_no, AKO_EVENT_COMPRESSION_END, c->events_data, c->events);
 
 		// 4. Developers, developers, developers
 		if (t < AKO_DEV_NOISE)
 		{
 			AKO_DEV_PRINTF(
-			    "E\tTile %zu at %zu:%zu, %zux%zu px, planes spacing: %zu, size: %zu bytes, blob size: %zu bytes\n", t,
-			    tile_x, tile_y, tile_w, tile_h, planes_spacing, tile_data_size, blob_size);
+			    "E\tTile %zu at %zu:%zu, %zux%zu px, planes spacing: %zu, size: %zu bytes, output: %zu bytes\n", t,
+			    tile_x, tile_y, tile_w, tile_h, planes_spacing, tile_data_size, w->out_used);
 		}
 		else if (t == AKO_DEV_NOISE + 1)
 		{
 			AKO_DEV_PRINTF("E\t...\n");
 		}
+	}
+
+	w->status = AKO_OK;
+}
+
+
+static void sEncodeWorker(size_t worker_no, void* raw_workers)
+{
+	struct akoEncodeWorker* workers = raw_workers;
+	sEncodeTiles(&workers[worker_no]);
+}
 
-		// 5. Next tile
-		tile_x += checked_s.tiles_dimension;
-		if (tile_x >= image_w)
+
+static void sCheckSettings(struct akoSettings* s)
+{
+	if (s->color == AKO_COLOR_YCOCG && (s->quantization > 0 || s->gate > 0))
+		s->color = AKO_COLOR_YCOCG_Q;
+	else if (s->color == AKO_COLOR_YCOCG_Q && (s->quantization <= 0 && s->gate <= 0))
+		s->color = AKO_COLOR_YCOCG;
+}
+
+
+struct akoEncodeContext
+{
+	struct akoCallbacks c;
+
+	size_t workers_no; // Allocated ones, an image may use less
+	struct akoEncodeWorker* workers;
+	size_t workareas_size; // Of each workarea
+
+	size_t tiles_no; // Entries in 'tiles_size'
+	size_t* tiles_size;
+};
+
+
+static enum akoStatus sContextInit(struct akoEncodeContext* ctx, const struct akoCallbacks* c)
+{
+	ctx->c = (c != NULL) ? *c : akoDefaultCallbacks();
+	ctx->workers_no = 0;
+	ctx->workers = NULL;
+	ctx->workareas_size = 0;
+	ctx->tiles_no = 0;
+	ctx->tiles_size = NULL;
+
+	if (ctx->c.malloc == NULL || ctx->c.realloc == NULL || ctx->c.free == NULL)
+		return AKO_INVALID_CALLBACKS;
+
+	return AKO_OK;
+}
+
+
+static void sContextRelease(struct akoEncodeContext* ctx)
+{
+	for (size_t i = 0; i < ctx->workers_no; i++)
+	{
+		if (ctx->workers[i].workarea_a != NULL)
+			ctx->c.free(ctx->workers[i].workarea_a);
+		if (ctx->workers[i].workarea_b != NULL)
+			ctx->c.free(ctx->workers[i].workarea_b);
+		if (ctx->workers[i].workarea_c != NULL)
+			ctx->c.free(ctx->workers[i].workarea_c);
+	}
+
+	if (ctx->workers != NULL)
+		ctx->c.free(ctx->workers);
+	if (ctx->tiles_size != NULL)
+		ctx->c.free(ctx->tiles_size);
+
+	ctx->workers_no = 0;
+	ctx->workers = NULL;
+	ctx->workareas_size = 0;
+	ctx->tiles_no = 0;
+	ctx->tiles_size = NULL;
+}
+
+
+static size_t* sContextTilesSize(struct akoEncodeContext* ctx, size_t tiles_no)
+{
+	// Only grows
+	if (tiles_no > ctx->tiles_no)
+	{
+		if (ctx->tiles_size != NULL)
+			ctx->c.free(ctx->tiles_size);
+
+		ctx->tiles_no = 0;
+		if ((ctx->tiles_size = ctx->c.malloc(sizeof(size_t) * tiles_no)) == NULL)
+			return NULL;
+
+		ctx->tiles_no = tiles_no;
+	}
+
+	return ctx->tiles_size;
+}
+
+
+static struct akoEncodeWorker* sContextWorkers(struct akoEncodeContext* ctx, const struct akoSettings* s,
+                                               size_t channels, size_t image_w, size_t image_h, size_t jobs_no,
+                                               size_t* tiles_size, size_t* out_workers_no)
+{
+	// Each worker with its own workareas, these, and workers, only grow. Once a
+	// context encoded the biggest image it will see, following ones are free
+	const size_t tile_total_size = (akoImageMaxTileDataSize(image_w, image_h, s->tiles_dimension) +
+	                                akoImageMaxPlanesSpacingSize(image_w, image_h, s->tiles_dimension)) *
+	                               channels;
+
+	const size_t workers_no = akoThreadsNo(ctx->c.threads, jobs_no);
+
+	if (workers_no > ctx->workers_no)
+	{
+		struct akoEncodeWorker* workers =
+		    ctx->c.realloc(ctx->workers, sizeof(struct akoEncodeWorker) * workers_no);
+
+		if (workers == NULL)
+			return NULL;
+
+		for (size_t i = ctx->workers_no; i < workers_no; i++)
 		{
-			tile_x = 0;
-			tile_y += checked_s.tiles_dimension;
+			workers[i].workarea_a = NULL;
+			workers[i].workarea_b = NULL;
+			workers[i].workarea_c = NULL;
 		}
+
+		ctx->workers = workers;
+		ctx->workers_no = workers_no;
+	}
+
+	if (tile_total_size > ctx->workareas_size)
+	{
+		for (size_t i = 0; i < ctx->workers_no; i++)
+		{
+			if (ctx->workers[i].workarea_a != NULL)
+				ctx->c.free(ctx->workers[i].workarea_a);
+			if (ctx->workers[i].workarea_b != NULL)
+				ctx->c.free(ctx->workers[i].workarea_b);
+			if (ctx->workers[i].workarea_c != NULL)
+				ctx->c.free(ctx->workers[i].workarea_c);
+
+			ctx->workers[i].workarea_a = NULL;
+			ctx->workers[i].workarea_b = NULL;
+			ctx->workers[i].workarea_c = NULL;
+		}
+
+		ctx->workareas_size = tile_total_size;
+	}
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		struct akoEncodeWorker* w = &ctx->workers[i];
+
+		w->c = &ctx->c;
+		w->s = s;
+		w->channels = channels;
+		w->image_w = image_w;
+		w->image_h = image_h;
+		w->in = NULL;
+		w->in_row = 0;
+		w->in_stride = 0;
+
+		w->tiles_no = akoImageTilesNo(image_w, image_h, s->tiles_dimension);
+		w->tile_start = 0;
+		w->tile_end = 0;
+
+		for (size_t q = 0; q < 4; q++)
+			w->quantization[q].tile_w = 0; // Settings may have changed
+
+		if (w->workarea_a == NULL)
+			w->workarea_a = ctx->c.malloc(ctx->workareas_size);
+		if (w->workarea_b == NULL)
+			w->workarea_b = ctx->c.malloc(ctx->workareas_size);
+		if (w->workarea_c == NULL && s->compression == AKO_COMPRESSION_MANBAVARAN)
+			w->workarea_c = ctx->c.malloc(ctx->workareas_size);
+
+		w->tiles_size = tiles_size;
+
+		w->out = NULL;
+		w->out_size = 0;
+		w->out_used = 0;
+		w->grow = 0;
+		w->status = AKO_ERROR;
+
+		if (w->workarea_a == NULL || w->workarea_b == NULL)
+			return NULL;
+		if (w->workarea_c == NULL && s->compression == AKO_COMPRESSION_MANBAVARAN)
+			return NULL;
+	}
+
+	AKO_DEV_PRINTF("\nE\tTile total size: %zu, Workers: %zu\n", tile_total_size, workers_no);
+
+	*out_workers_no = workers_no;
+	return ctx->workers;
+}
+
+
+static enum akoStatus sWorkersRun(size_t workers_no, struct akoEncodeWorker* workers, const void* in, size_t in_row,
+                                  size_t in_stride, size_t tile_start, size_t tile_end, size_t out_size, uint8_t* out,
+                                  size_t* out_used)
+{
+	const struct akoEncodeWorker* w0 = &workers[0];
+	const size_t jobs_no = tile_end - tile_start;
+
+	// Only knowing the worst case of all tiles, each worker can start
+	// at a known position. Otherwise we go one tile after the other
+	if (out_size < sTilesBound(w0->s, w0->channels, w0->image_w, w0->image_h, tile_start, tile_end))
+		workers_no = 1;
+
+	// Split tiles in contiguous ranges
+	size_t out_start = 0;
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		struct akoEncodeWorker* w = &workers[i];
+
+		w->in = in;
+		w->in_row = in_row;
+		w->in_stride = in_stride;
+		w->tile_start = tile_start + (jobs_no * (i + 0)) / workers_no;
+		w->tile_end = tile_start + (jobs_no * (i + 1)) / workers_no;
+
+		w->out = out + out_start;
+		w->out_size = (i != workers_no - 1)
+		                  ? sTilesBound(w->s, w->channels, w->image_w, w->image_h, w->tile_start, w->tile_end)
+		                  : (out_size - out_start);
+		w->out_used = 0;
+		w->grow = 0;
+
+		out_start += w->out_size;
+	}
+
+	// Iterate tiles
+	if (workers_no == 1)
+		sEncodeTiles(&workers[0]);
+	else
+		akoThreadsRun(workers_no, sEncodeWorker, workers);
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		if (workers[i].status != AKO_OK)
+			return workers[i].status;
+	}
+
+	// Close gaps between workers outputs
+	*out_used = workers[0].out_used;
+
+	for (size_t i = 1; i < workers_no; i++)
+	{
+		__builtin_memmove(out + *out_used, workers[i].out, workers[i].out_used);
+		*out_used += workers[i].out_used;
+	}
+
+	return AKO_OK;
+}
+
+
+static enum akoStatus sWorkersRunGrowing(size_t workers_no, struct akoEncodeWorker* workers, const void* in,
+                                         size_t in_stride, size_t tiles_no, size_t head_size, uint8_t** out,
+                                         size_t* out_used)
+{
+	// Same as above, but workers allocate their outputs, growing them as tiles need.
+	// At the end, the first one (that left space for the head) is the final output
+	// with the others appended
+	enum akoStatus status = AKO_OK;
+	size_t total = 0;
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		struct akoEncodeWorker* w = &workers[i];
+
+		w->in = in;
+		w->in_row = 0;
+		w->in_stride = in_stride;
+		w->tile_start = (tiles_no * (i + 0)) / workers_no;
+		w->tile_end = (tiles_no * (i + 1)) / workers_no;
+
+		w->out = NULL;
+		w->out_size = 0;
+		w->out_used = (i == 0) ? head_size : 0;
+		w->grow = 1;
+		w->status = AKO_ERROR;
+	}
+
+	if (sWorkerGrow(&workers[0], head_size) == 0)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate tiles
+	if (workers_no == 1)
+		sEncodeTiles(&workers[0]);
+	else
+		akoThreadsRun(workers_no, sEncodeWorker, workers);
+
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		if ((status = workers[i].status) != AKO_OK)
+			goto return_failure;
+
+		total += workers[i].out_used;
+	}
+
+	// Concatenate
+	if (sWorkerGrow(&workers[0], total) == 0)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	for (size_t i = 1; i < workers_no; i++)
+	{
+		if (workers[i].out == NULL) // Had no tiles
+			continue;
+
+		__builtin_memcpy(workers[0].out + workers[0].out_used, workers[i].out, workers[i].out_used);
+		workers[0].out_used += workers[i].out_used;
+
+		workers[i].c->free(workers[i].out);
+		workers[i].out = NULL;
 	}
 
 	// Bye!
-	checked_c.free(workarea_a);
-	checked_c.free(workarea_b);
+	*out = workers[0].out;
+	*out_used = total - head_size;
+	workers[0].out = NULL;
+
+	for (size_t i = 0; i < workers_no; i++)
+		workers[i].grow = 0;
+
+	return AKO_OK;
+
+return_failure:
+	for (size_t i = 0; i < workers_no; i++)
+	{
+		if (workers[i].out != NULL)
+			workers[i].c->free(workers[i].out);
+
+		workers[i].out = NULL;
+		workers[i].grow = 0;
+	}
+
+	return status;
+}
+
+
+static size_t sEncode(struct akoEncodeContext* ctx, const struct akoSettings* s, size_t channels, size_t image_w,
+                      size_t image_h, size_t in_stride, const void* in, int grow, size_t output_size,
+                      uint8_t** output, enum akoStatus* out_status)
+{
+	// Output is either a buffer of 'output_size' bytes or, if 'grow' is set,
+	// allocated here as tiles need it ('output_size' ignored)
+
+	enum akoStatus status;
+	struct akoHead head;
+
+	struct akoEncodeWorker* workers = NULL;
+	size_t workers_no = 0;
+
+	size_t* tiles_size = NULL;
+
+	// Check settings and input
+	struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+	sCheckSettings(&checked_s);
+
+	in_stride = (in_stride != 0) ? in_stride : (image_w * channels);
+
+	if (in == NULL || output == NULL || (grow == 0 && *output == NULL) || in_stride < image_w * channels)
+	{
+		status = AKO_INVALID_INPUT;
+		goto return_failure;
+	}
+
+	// Write head, with space for the index (if any)
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, checked_s.tiles_dimension);
+	const size_t index_size = (checked_s.tiles_index != 0) ? akoIndexSize(tiles_no) : 0;
+	const size_t head_size = sizeof(struct akoHead) + index_size;
+
+	if (grow == 0 && output_size < head_size)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if ((status = akoHeadWrite(channels, image_w, image_h, &checked_s, &head)) != AKO_OK)
+		goto return_failure;
+
+	if (index_size != 0)
+	{
+		if ((tiles_size = sContextTilesSize(ctx, tiles_no)) == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
 
+	// Workers
+	if ((workers = sContextWorkers(ctx, &checked_s, channels, image_w, image_h, tiles_no, tiles_size,
+	                               &workers_no)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Iterate tiles
+	size_t tiles_used;
+
+	if (grow != 0)
+		status = sWorkersRunGrowing(workers_no, workers, in, in_stride, tiles_no, head_size, output, &tiles_used);
+	else
+		status = sWorkersRun(workers_no, workers, in, 0, in_stride, 0, tiles_no, output_size - head_size,
+		                     *output + head_size, &tiles_used);
+
+	if (status != AKO_OK)
+		goto return_failure;
+
+	// Write head and index, now that we know where each tile is
+	__builtin_memcpy(*output, &head, sizeof(struct akoHead));
+
+	if (index_size != 0)
+	{
+		size_t offset = head_size;
+		for (size_t t = 0; t < tiles_no; t++)
+		{
+			akoIndexWrite(t, offset, *output + sizeof(struct akoHead));
+			offset += tiles_size[t];
+		}
+	}
+
+	// Bye!
 	if (out_status != NULL)
 		*out_status = AKO_OK;
 
+	return head_size + tiles_used;
+
+return_failure:
+	if (out_status != NULL)
+		*out_status = status;
+
+	return 0;
+}
+
+
+AKO_EXPORT struct akoEncodeContext* akoEncodeContextCreate(const struct akoCallbacks* c, enum akoStatus* out_status)
+{
+	struct akoEncodeContext temp;
+	struct akoEncodeContext* ctx;
+	enum akoStatus status;
+
+	if ((status = sContextInit(&temp, c)) != AKO_OK)
+		goto return_failure;
+
+	if ((ctx = temp.c.malloc(sizeof(struct akoEncodeContext))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	*ctx = temp;
+
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return ctx;
+
+return_failure:
+	if (out_status != NULL)
+		*out_status = status;
+
+	return NULL;
+}
+
+
+AKO_EXPORT void akoEncodeContextDelete(struct akoEncodeContext* ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	sContextRelease(ctx);
+	ctx->c.free(ctx);
+}
+
+
+AKO_EXPORT size_t akoEncodeWithContext(struct akoEncodeContext* ctx, const struct akoSettings* s, size_t channels,
+                                       size_t image_w, size_t image_h, size_t in_stride, const void* in,
+                                       size_t output_size, void* output, enum akoStatus* out_status)
+{
+	if (ctx == NULL)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_INPUT;
+		return 0;
+	}
+
+	uint8_t* out = output;
+	return sEncode(ctx, s, channels, image_w, image_h, in_stride, in, 0, output_size, &out, out_status);
+}
+
+
+AKO_EXPORT size_t akoEncodeBound(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h)
+{
+	const struct akoSettings checked_s = (s != NULL) ? *s : akoDefaultSettings();
+	const size_t tiles_no = akoImageTilesNo(image_w, image_h, checked_s.tiles_dimension);
+
+	return sizeof(struct akoHead) + ((checked_s.tiles_index != 0) ? akoIndexSize(tiles_no) : 0) +
+	       sTilesBound(&checked_s, channels, image_w, image_h, 0, tiles_no);
+}
+
+
+AKO_EXPORT size_t akoEncodeInto(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
+                                size_t image_w, size_t image_h, size_t in_stride, const void* in, size_t output_size,
+                                void* output, enum akoStatus* out_status)
+{
+	struct akoEncodeContext ctx;
+	enum akoStatus status;
+	size_t size = 0;
+
+	uint8_t* out = output;
+
+	// A context just for this image
+	if ((status = sContextInit(&ctx, c)) == AKO_OK)
+		size = sEncode(&ctx, s, channels, image_w, image_h, in_stride, in, 0, output_size, &out, &status);
+
+	sContextRelease(&ctx);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return size;
+}
+
+
+AKO_EXPORT size_t akoEncodeStrided(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
+                                   size_t image_w, size_t image_h, size_t in_stride, const void* in, void** out,
+                                   enum akoStatus* out_status)
+{
+	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
+	uint8_t* blob = NULL;
+
+	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_CALLBACKS;
+		return 0;
+	}
+
+	// Output grows as tiles get compressed, then we give back what we didn't use. Allocating
+	// akoEncodeBound() up front would mean twice the input size, whatever the compression
+	struct akoEncodeContext ctx;
+	sContextInit(&ctx, &checked_c); // Callbacks already checked
+
+	const size_t blob_size = sEncode(&ctx, s, channels, image_w, image_h, in_stride, in, 1, 0, &blob, out_status);
+	sContextRelease(&ctx);
+
+	if (blob_size == 0)
+		return 0;
+
 	if (out != NULL)
-		*out = blob;
+	{
+		void* shrunk_blob = checked_c.realloc(blob, blob_size);
+		*out = (shrunk_blob != NULL) ? shrunk_blob : blob;
+	}
 	else
 		checked_c.free(blob); // Discard encoded data
 
 	return blob_size;
+}
+
+
+AKO_EXPORT size_t akoEncodeExt(const struct akoCallbacks* c, const struct akoSettings* s, size_t channels,
+                               size_t image_w, size_t image_h, const void* in, void** out, enum akoStatus* out_status)
+{
+	return akoEncodeStrided(c, s, channels, image_w, image_h, 0, in, out, out_status);
+}
+
+
+//
+
+
+struct akoEncoder
+{
+	struct akoCallbacks c;
+	struct akoSettings s;
+	size_t channels;
+	size_t image_w;
+	size_t image_h;
+
+	void (*write)(size_t offset, size_t size, const void* data, void* user_data);
+	void* write_data;
+
+	size_t tiles_no;
+	size_t tiles_x;   // Tiles per row
+	size_t band_h;    // Rows per band (a row of tiles)
+	size_t band_no;   // Band being filled
+	size_t band_rows; // Rows already in it
+	uint8_t* band;
+
+	uint8_t* band_out; // Where a band of tiles gets compressed
+	size_t band_out_size;
+
+	uint8_t* head; // Followed by the index, written again (with offsets) at the end
+	size_t index_size;
+	size_t* tiles_size;
+
+	struct akoEncodeContext ctx; // Owns above 'tiles_size', and workers
+	struct akoEncodeWorker* workers;
+	size_t workers_no;
+
+	size_t blob_size; // What we wrote so far
+	enum akoStatus status;
+};
+
+
+static void sEncoderDelete(struct akoEncoder* e)
+{
+	sContextRelease(&e->ctx);
+
+	if (e->head != NULL)
+		e->c.free(e->head);
+	if (e->band != NULL)
+		e->c.free(e->band);
+	if (e->band_out != NULL)
+		e->c.free(e->band_out);
+
+	e->c.free(e);
+}
+
+
+AKO_EXPORT struct akoEncoder* akoEncoderBegin(const struct akoCallbacks* c, const struct akoSettings* s,
+                                              size_t channels, size_t image_w, size_t image_h,
+                                              void (*write)(size_t offset, size_t size, const void* data,
+                                                            void* user_data),
+                                              void* write_data, enum akoStatus* out_status)
+{
+	enum akoStatus status;
+	struct akoEncoder* e = NULL;
+
+	// Check callbacks
+	const struct akoCallbacks checked_c = (c != NULL) ? *c : akoDefaultCallbacks();
+
+	if (checked_c.malloc == NULL || checked_c.realloc == NULL || checked_c.free == NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	if (write == NULL)
+	{
+		status = AKO_INVALID_CALLBACKS;
+		goto return_failure;
+	}
+
+	// Allocate encoder
+	if ((e = checked_c.malloc(sizeof(struct akoEncoder))) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	e->c = checked_c;
+	e->s = (s != NULL) ? *s : akoDefaultSettings();
+	e->channels = channels;
+	e->image_w = image_w;
+	e->image_h = image_h;
+
+	e->write = write;
+	e->write_data = write_data;
+
+	e->band = NULL;
+	e->band_out = NULL;
+	e->head = NULL;
+	e->tiles_size = NULL;
+	e->workers = NULL;
+	e->workers_no = 0;
+
+	sContextInit(&e->ctx, &checked_c); // Callbacks already checked
+
+	sCheckSettings(&e->s);
+
+	// Write head, index goes empty for now
+	e->tiles_no = akoImageTilesNo(image_w, image_h, e->s.tiles_dimension);
+	e->index_size = (e->s.tiles_index != 0) ? akoIndexSize(e->tiles_no) : 0;
+
+	if ((e->head = checked_c.malloc(sizeof(struct akoHead) + e->index_size)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if ((status = akoHeadWrite(channels, image_w, image_h, &e->s, e->head)) != AKO_OK)
+		goto return_failure;
+
+	for (size_t i = 0; i < e->index_size; i++)
+		e->head[sizeof(struct akoHead) + i] = 0;
+
+	if (e->index_size != 0)
+	{
+		if ((e->tiles_size = sContextTilesSize(&e->ctx, e->tiles_no)) == NULL)
+		{
+			status = AKO_NO_ENOUGH_MEMORY;
+			goto return_failure;
+		}
+	}
+
+	// Allocate band and workers, these only need to handle a row of tiles
+	e->tiles_x = (e->s.tiles_dimension != 0) ? (image_w / e->s.tiles_dimension +
+	                                            ((image_w % e->s.tiles_dimension != 0) ? 1 : 0))
+	                                         : 1;
+	e->band_h = akoTileDimension(0, image_h, e->s.tiles_dimension);
+	e->band_no = 0;
+	e->band_rows = 0;
+
+	if ((e->band = checked_c.malloc(image_w * e->band_h * channels)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Only the last band can be smaller than the first one
+	{
+		const size_t first = sTilesBound(&e->s, channels, image_w, image_h, 0, e->tiles_x);
+		const size_t last = sTilesBound(&e->s, channels, image_w, image_h, e->tiles_no - e->tiles_x, e->tiles_no);
+		e->band_out_size = (first > last) ? first : last;
+	}
+
+	if ((e->band_out = checked_c.malloc(e->band_out_size)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	if ((e->workers = sContextWorkers(&e->ctx, &e->s, channels, image_w, image_h, e->tiles_x, e->tiles_size,
+	                                  &e->workers_no)) == NULL)
+	{
+		status = AKO_NO_ENOUGH_MEMORY;
+		goto return_failure;
+	}
+
+	// Bye!
+	e->write(0, sizeof(struct akoHead) + e->index_size, e->head, e->write_data);
+	e->blob_size = sizeof(struct akoHead) + e->index_size;
+	e->status = AKO_OK;
+
+	if (out_status != NULL)
+		*out_status = AKO_OK;
+
+	return e;
 
 return_failure:
-	if (workarea_a != NULL)
-		checked_c.free(workarea_a);
-	if (workarea_b != NULL)
-		checked_c.free(workarea_b);
+	if (e != NULL)
+		sEncoderDelete(e);
 	if (out_status != NULL)
 		*out_status = status;
-	if (blob != NULL)
-		checked_c.free(blob);
 
-	return 0;
+	return NULL;
+}
+
+
+AKO_EXPORT enum akoStatus akoEncoderPushRows(struct akoEncoder* e, size_t rows_no, const void* rows)
+{
+	if (e == NULL)
+		return AKO_INVALID_INPUT;
+
+	const uint8_t* in = rows;
+	const size_t row_size = e->image_w * e->channels;
+
+	if (e->status != AKO_OK)
+		return e->status;
+
+	if (rows == NULL)
+		return AKO_INVALID_INPUT;
+
+	while (rows_no != 0)
+	{
+		const size_t band_y = e->band_no * e->band_h;
+
+		if (band_y >= e->image_h)
+		{
+			e->status = AKO_INVALID_INPUT; // More rows than the image has
+			return e->status;
+		}
+
+		// Fill band
+		const size_t band_h = akoTileDimension(band_y, e->image_h, e->s.tiles_dimension);
+		const size_t copy_rows = (rows_no < band_h - e->band_rows) ? rows_no : (band_h - e->band_rows);
+
+		for (size_t i = 0; i < row_size * copy_rows; i++)
+			e->band[row_size * e->band_rows + i] = in[i];
+
+		e->band_rows += copy_rows;
+		rows_no -= copy_rows;
+		in += row_size * copy_rows;
+
+		if (e->band_rows != band_h)
+			break;
+
+		// Encode its tiles
+		const size_t tile_start = e->band_no * e->tiles_x;
+		size_t band_out_used;
+
+		if ((e->status = sWorkersRun(e->workers_no, e->workers, e->band, band_y, row_size, tile_start,
+		                             tile_start + e->tiles_x, e->band_out_size, e->band_out, &band_out_used)) != AKO_OK)
+			return e->status;
+
+		// And write them
+		e->write(e->blob_size, band_out_used, e->band_out, e->write_data);
+		e->blob_size += band_out_used;
+
+		e->band_no += 1;
+		e->band_rows = 0;
+	}
+
+	return AKO_OK;
+}
+
+
+AKO_EXPORT size_t akoEncoderFinish(struct akoEncoder* e, enum akoStatus* out_status)
+{
+	if (e == NULL)
+	{
+		if (out_status != NULL)
+			*out_status = AKO_INVALID_INPUT;
+		return 0;
+	}
+
+	enum akoStatus status = e->status;
+	size_t blob_size = 0;
+
+	if (status == AKO_OK && e->band_no * e->band_h < e->image_h)
+		status = AKO_INVALID_INPUT; // Image incomplete
+
+	// Write index, now that we know where each tile is
+	if (status == AKO_OK && e->index_size != 0)
+	{
+		size_t offset = sizeof(struct akoHead) + e->index_size;
+		for (size_t t = 0; t < e->tiles_no; t++)
+		{
+			akoIndexWrite(t, offset, e->head + sizeof(struct akoHead));
+			offset += e->tiles_size[t];
+		}
+
+		e->write(sizeof(struct akoHead), e->index_size, e->head + sizeof(struct akoHead), e->write_data);
+	}
+
+	if (status == AKO_OK)
+		blob_size = e->blob_size;
+
+	// Bye!
+	sEncoderDelete(e);
+
+	if (out_status != NULL)
+		*out_status = status;
+
+	return blob_size;
 }
@@ -26,49 +26,381 @@ SOFTWARE.
 
 #include "ako-private.h"
 
+#if (AKO_SIMD_X86 == 1)
+#include <immintrin.h>
+#endif
 
-static inline void sDeinterleave(int discard_non_visible, size_t channels, size_t width, size_t in_stride,
-                                 size_t out_plane, const uint8_t* in, const uint8_t* in_end, int16_t* out)
+
+static inline void sDeinterleaveRow(int discard_non_visible, size_t channels, size_t width, size_t out_plane,
+                                    const uint8_t* in, int16_t* out)
 {
 	if (discard_non_visible != 0)
 	{
-		for (; in < in_end; in += in_stride, out += width)
-			for (size_t col = 0; col < width; col++)
+		for (size_t col = 0; col < width; col++)
+		{
+			out[out_plane * (channels - 1) + col] = in[col * channels + (channels - 1)];
+
+			if (in[col * channels + (channels - 1)] != 0)
 			{
-				out[out_plane * (channels - 1) + col] = in[col * channels + (channels - 1)];
-
-				if (in[col * channels + (channels - 1)] != 0)
-				{
-					for (size_t ch = 0; ch < (channels - 1); ch++)
-						out[out_plane * ch + col] = in[col * channels + ch];
-				}
-				else
-				{
-					for (size_t ch = 0; ch < (channels - 1); ch++)
-						out[out_plane * ch + col] = 0;
-				}
+				for (size_t ch = 0; ch < (channels - 1); ch++)
+					out[out_plane * ch + col] = in[col * channels + ch];
 			}
+			else
+			{
+				for (size_t ch = 0; ch < (channels - 1); ch++)
+					out[out_plane * ch + col] = 0;
+			}
+		}
 	}
 	else
 	{
-		for (; in < in_end; in += in_stride, out += width)
-			for (size_t col = 0; col < width; col++)
-			{
-				for (size_t ch = 0; ch < channels; ch++)
-					out[out_plane * ch + col] = in[col * channels + ch];
-			}
+		for (size_t col = 0; col < width; col++)
+		{
+			for (size_t ch = 0; ch < channels; ch++)
+				out[out_plane * ch + col] = in[col * channels + ch];
+		}
 	}
 }
 
+static inline void sDeinterleave(int discard_non_visible, size_t channels, size_t width, size_t in_stride,
+                                 size_t out_plane, const uint8_t* in, const uint8_t* in_end, int16_t* out)
+{
+	for (; in < in_end; in += in_stride, out += width)
+		sDeinterleaveRow(discard_non_visible, channels, width, out_plane, in, out);
+}
+
+
+static inline void sToYuv(enum akoColor color, size_t out_plane, int16_t* out) // One pixel, in place
+{
+	const int16_t r = out[out_plane * 0];
+	const int16_t g = out[out_plane * 1];
+	const int16_t b = out[out_plane * 2];
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		// https://en.wikipedia.org/wiki/YCoCg#Conversion_with_the_RGB_color_model
+		out[out_plane * 1] = (int16_t)(r - b);
+		const int16_t temp = (int16_t)(b + ((r - b) / 2));
+		out[out_plane * 2] = (int16_t)(g - temp);
+		out[out_plane * 0] = (int16_t)(temp + ((g - temp) / 2));
+
+		if (color == AKO_COLOR_YCOCG_Q)
+			out[out_plane * 0] = (int16_t)(out[out_plane * 0] * 2);
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+	{
+		// https://developers.google.com/speed/webp/docs/compression#subtract_green_transform
+		out[out_plane * 0] = (int16_t)(g);
+		out[out_plane * 1] = (int16_t)(r - g);
+		out[out_plane * 2] = (int16_t)(b - g);
+	}
+}
+
+
+// Simd versions of above, deinterleaving, converting and transforming color
+// in one go, a row at time. Start at column 'c' and return where they stopped.
+// Rgb needs byte shuffles (Ssse3, so our Sse4.1 level), Rgba just shifts.
+
+#if (AKO_SIMD_X86 == 1)
+static inline __m128i sHalfSse2(__m128i x) // Rounding towards zero, as C does
+{
+	return _mm_srai_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 15)), 1);
+}
+
+static inline void sToYuvSse2(enum akoColor color, __m128i* a, __m128i* b, __m128i* c)
+{
+	const __m128i r = *a;
+	const __m128i g = *b;
+	const __m128i bl = *c;
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		const __m128i co = _mm_sub_epi16(r, bl);
+		const __m128i temp = _mm_add_epi16(bl, sHalfSse2(co));
+		const __m128i cg = _mm_sub_epi16(g, temp);
+		const __m128i y = _mm_add_epi16(temp, sHalfSse2(cg));
+
+		*a = (color == AKO_COLOR_YCOCG_Q) ? _mm_slli_epi16(y, 1) : y;
+		*b = co;
+		*c = cg;
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+	{
+		*a = g;
+		*b = _mm_sub_epi16(r, g);
+		*c = _mm_sub_epi16(bl, g);
+	}
+}
+
+static inline size_t sRgbaToYuvLoopSse2(enum akoColor color, int discard_non_visible, size_t c, size_t end,
+                                        size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i v0 = _mm_loadu_si128((const __m128i*)(in + c * 4));
+		const __m128i v1 = _mm_loadu_si128((const __m128i*)(in + c * 4 + 16));
+
+		__m128i r = _mm_packs_epi32(_mm_and_si128(v0, mask), _mm_and_si128(v1, mask));
+		__m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 8), mask),
+		                            _mm_and_si128(_mm_srli_epi32(v1, 8), mask));
+		__m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 16), mask),
+		                            _mm_and_si128(_mm_srli_epi32(v1, 16), mask));
+		const __m128i a = _mm_packs_epi32(_mm_srli_epi32(v0, 24), _mm_srli_epi32(v1, 24));
+
+		if (discard_non_visible != 0)
+		{
+			const __m128i invisible = _mm_cmpeq_epi16(a, _mm_setzero_si128());
+			r = _mm_andnot_si128(invisible, r);
+			g = _mm_andnot_si128(invisible, g);
+			b = _mm_andnot_si128(invisible, b);
+		}
+
+		sToYuvSse2(color, &r, &g, &b);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 0 + c), r);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 1 + c), g);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 2 + c), b);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 3 + c), a);
+	}
+
+	return c;
+}
+
+static size_t sRgbaToYuvSse2(enum akoColor color, int discard_non_visible, size_t c, size_t end, size_t out_plane,
+                             const uint8_t* in, int16_t* out)
+{
+	// Specialized by color, compilers do the rest
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sRgbaToYuvLoopSse2(AKO_COLOR_YCOCG, discard_non_visible, c, end, out_plane, in, out);
+	case AKO_COLOR_YCOCG_Q:
+		return sRgbaToYuvLoopSse2(AKO_COLOR_YCOCG_Q, discard_non_visible, c, end, out_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G:
+		return sRgbaToYuvLoopSse2(AKO_COLOR_SUBTRACT_G, discard_non_visible, c, end, out_plane, in, out);
+	default: return sRgbaToYuvLoopSse2(AKO_COLOR_NONE, discard_non_visible, c, end, out_plane, in, out);
+	}
+}
+
+AKO_TARGET_SSE4_1 static inline size_t sRgbToYuvLoopSse4(enum akoColor color, size_t c, size_t end,
+                                                         size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	// Eight pixels from 24 bytes, shuffles leave each byte as an int16 (-1 = zero)
+	const __m128i r_lo = _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1);
+	const __m128i r_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1);
+	const __m128i g_lo = _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i g_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1);
+	const __m128i b_lo = _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i b_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1);
+
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i lo = _mm_loadu_si128((const __m128i*)(in + c * 3));
+		const __m128i hi = _mm_loadl_epi64((const __m128i*)(in + c * 3 + 16));
+
+		__m128i r = _mm_or_si128(_mm_shuffle_epi8(lo, r_lo), _mm_shuffle_epi8(hi, r_hi));
+		__m128i g = _mm_or_si128(_mm_shuffle_epi8(lo, g_lo), _mm_shuffle_epi8(hi, g_hi));
+		__m128i b = _mm_or_si128(_mm_shuffle_epi8(lo, b_lo), _mm_shuffle_epi8(hi, b_hi));
+
+		sToYuvSse2(color, &r, &g, &b);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 0 + c), r);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 1 + c), g);
+		_mm_storeu_si128((__m128i*)(out + out_plane * 2 + c), b);
+	}
+
+	return c;
+}
+
+AKO_TARGET_SSE4_1 static size_t sRgbToYuvSse4(enum akoColor color, int discard_non_visible, size_t c, size_t end,
+                                              size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	(void)discard_non_visible; // No alpha
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sRgbToYuvLoopSse4(AKO_COLOR_YCOCG, c, end, out_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sRgbToYuvLoopSse4(AKO_COLOR_YCOCG_Q, c, end, out_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sRgbToYuvLoopSse4(AKO_COLOR_SUBTRACT_G, c, end, out_plane, in, out);
+	default: return sRgbToYuvLoopSse4(AKO_COLOR_NONE, c, end, out_plane, in, out);
+	}
+}
+
+
+AKO_TARGET_AVX2 static inline __m256i sHalfAvx2(__m256i x)
+{
+	return _mm256_srai_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 15)), 1);
+}
+
+AKO_TARGET_AVX2 static inline void sToYuvAvx2(enum akoColor color, __m256i* a, __m256i* b, __m256i* c)
+{
+	const __m256i r = *a;
+	const __m256i g = *b;
+	const __m256i bl = *c;
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		const __m256i co = _mm256_sub_epi16(r, bl);
+		const __m256i temp = _mm256_add_epi16(bl, sHalfAvx2(co));
+		const __m256i cg = _mm256_sub_epi16(g, temp);
+		const __m256i y = _mm256_add_epi16(temp, sHalfAvx2(cg));
+
+		*a = (color == AKO_COLOR_YCOCG_Q) ? _mm256_slli_epi16(y, 1) : y;
+		*b = co;
+		*c = cg;
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+	{
+		*a = g;
+		*b = _mm256_sub_epi16(r, g);
+		*c = _mm256_sub_epi16(bl, g);
+	}
+}
+
+AKO_TARGET_AVX2 static inline size_t sRgbaToYuvLoopAvx2(enum akoColor color, int discard_non_visible, size_t c,
+                                                        size_t end, size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	const __m256i mask = _mm256_set1_epi32(0xFF);
+
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i v0 = _mm256_loadu_si256((const __m256i*)(in + c * 4));
+		const __m256i v1 = _mm256_loadu_si256((const __m256i*)(in + c * 4 + 32));
+
+		// Packs work per 128 bits lane, permutes put pixels back in order
+		__m256i r = _mm256_packs_epi32(_mm256_and_si256(v0, mask), _mm256_and_si256(v1, mask));
+		__m256i g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(v0, 8), mask),
+		                               _mm256_and_si256(_mm256_srli_epi32(v1, 8), mask));
+		__m256i b = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(v0, 16), mask),
+		                               _mm256_and_si256(_mm256_srli_epi32(v1, 16), mask));
+		__m256i a = _mm256_packs_epi32(_mm256_srli_epi32(v0, 24), _mm256_srli_epi32(v1, 24));
+
+		r = _mm256_permute4x64_epi64(r, 0xD8);
+		g = _mm256_permute4x64_epi64(g, 0xD8);
+		b = _mm256_permute4x64_epi64(b, 0xD8);
+		a = _mm256_permute4x64_epi64(a, 0xD8);
+
+		if (discard_non_visible != 0)
+		{
+			const __m256i invisible = _mm256_cmpeq_epi16(a, _mm256_setzero_si256());
+			r = _mm256_andnot_si256(invisible, r);
+			g = _mm256_andnot_si256(invisible, g);
+			b = _mm256_andnot_si256(invisible, b);
+		}
+
+		sToYuvAvx2(color, &r, &g, &b);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 0 + c), r);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 1 + c), g);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 2 + c), b);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 3 + c), a);
+	}
+
+	_mm256_zeroupper();
+	return sRgbaToYuvSse2(color, discard_non_visible, c, end, out_plane, in, out);
+}
+
+AKO_TARGET_AVX2 static size_t sRgbaToYuvAvx2(enum akoColor color, int discard_non_visible, size_t c, size_t end,
+                                             size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sRgbaToYuvLoopAvx2(AKO_COLOR_YCOCG, discard_non_visible, c, end, out_plane, in, out);
+	case AKO_COLOR_YCOCG_Q:
+		return sRgbaToYuvLoopAvx2(AKO_COLOR_YCOCG_Q, discard_non_visible, c, end, out_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G:
+		return sRgbaToYuvLoopAvx2(AKO_COLOR_SUBTRACT_G, discard_non_visible, c, end, out_plane, in, out);
+	default: return sRgbaToYuvLoopAvx2(AKO_COLOR_NONE, discard_non_visible, c, end, out_plane, in, out);
+	}
+}
+
+AKO_TARGET_AVX2 static inline size_t sRgbToYuvLoopAvx2(enum akoColor color, size_t c, size_t end, size_t out_plane,
+                                                       const uint8_t* in, int16_t* out)
+{
+	// As Sse4.1, with each 128 bits lane doing eight pixels
+	const __m256i r_lo = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1));
+	const __m256i r_hi = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1));
+	const __m256i g_lo = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1));
+	const __m256i g_hi = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1));
+	const __m256i b_lo = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1));
+	const __m256i b_hi = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1));
+
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i lo = _mm256_inserti128_si256(
+		    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + c * 3))),
+		    _mm_loadu_si128((const __m128i*)(in + c * 3 + 24)), 1);
+		const __m256i hi = _mm256_inserti128_si256(
+		    _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(in + c * 3 + 16))),
+		    _mm_loadl_epi64((const __m128i*)(in + c * 3 + 40)), 1);
+
+		__m256i r = _mm256_or_si256(_mm256_shuffle_epi8(lo, r_lo), _mm256_shuffle_epi8(hi, r_hi));
+		__m256i g = _mm256_or_si256(_mm256_shuffle_epi8(lo, g_lo), _mm256_shuffle_epi8(hi, g_hi));
+		__m256i b = _mm256_or_si256(_mm256_shuffle_epi8(lo, b_lo), _mm256_shuffle_epi8(hi, b_hi));
+
+		sToYuvAvx2(color, &r, &g, &b);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 0 + c), r);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 1 + c), g);
+		_mm256_storeu_si256((__m256i*)(out + out_plane * 2 + c), b);
+	}
+
+	_mm256_zeroupper();
+	return sRgbToYuvSse4(color, 0, c, end, out_plane, in, out);
+}
+
+AKO_TARGET_AVX2 static size_t sRgbToYuvAvx2(enum akoColor color, int discard_non_visible, size_t c, size_t end,
+                                            size_t out_plane, const uint8_t* in, int16_t* out)
+{
+	(void)discard_non_visible;
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sRgbToYuvLoopAvx2(AKO_COLOR_YCOCG, c, end, out_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sRgbToYuvLoopAvx2(AKO_COLOR_YCOCG_Q, c, end, out_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sRgbToYuvLoopAvx2(AKO_COLOR_SUBTRACT_G, c, end, out_plane, in, out);
+	default: return sRgbToYuvLoopAvx2(AKO_COLOR_NONE, c, end, out_plane, in, out);
+	}
+}
+#endif
+
 
 void akoFormatToPlanarI16Yuv(int discard_non_visible, enum akoColor color, size_t channels, size_t width, size_t height,
-                             size_t input_stride, size_t out_planes_spacing, const uint8_t* in, int16_t* out)
+                             size_t in_stride, size_t out_planes_spacing, const uint8_t* in, int16_t* out)
 {
-	// Deinterleave, convert from u8 to i16, and remove (or not) non visible pixels
+	const size_t out_plane = (width * height) + out_planes_spacing;
+
+	// Rgb(a), all in one go a row at time, with whatever kernels left for plain C
 	{
-		const size_t in_stride = input_stride * channels;
-		const size_t out_plane = (width * height) + out_planes_spacing;
+		const struct akoKernels* k = akoKernels();
+		size_t (*kernel)(enum akoColor, int, size_t, size_t, size_t, const uint8_t*, int16_t*) = NULL;
 
+		if (channels == 3)
+			kernel = k->format_rgb_to_yuv;
+		else if (channels == 4)
+			kernel = k->format_rgba_to_yuv;
+
+		if (kernel != NULL)
+		{
+			const uint8_t* in_end = in + in_stride * height;
+
+			for (; in < in_end; in += in_stride, out += width)
+			{
+				const size_t col = kernel(color, discard_non_visible, 0, width, out_plane, in, out);
+				sDeinterleaveRow((channels == 4) ? discard_non_visible : 0, channels, width - col, out_plane,
+				                 in + col * channels, out + col);
+
+				for (size_t c = col; c < width; c++)
+					sToYuv(color, out_plane, out + c);
+			}
+
+			return;
+		}
+	}
+
+	// Deinterleave, convert from u8 to i16, and remove (or not) non visible pixels
+	{
 		const uint8_t* in_end = in + in_stride * height;
 
 		if (channels == 3)
@@ -86,50 +418,20 @@ void akoFormatToPlanarI16Yuv(int discard_non_visible, enum akoColor color, size_
 	// Color transformation (to Yuv)
 	if (channels >= 3)
 	{
-		const size_t out_plane = (width * height) + out_planes_spacing;
-
 		if (color == AKO_COLOR_YCOCG)
 		{
-			// https://en.wikipedia.org/wiki/YCoCg#Conversion_with_the_RGB_color_model
 			for (size_t c = 0; c < (width * height); c++) // SIMD friendly :)
-			{
-				const int16_t r = out[out_plane * 0 + c];
-				const int16_t g = out[out_plane * 1 + c];
-				const int16_t b = out[out_plane * 2 + c];
-
-				out[out_plane * 1 + c] = (int16_t)(r - b);
-				const int16_t temp = (int16_t)(b + ((r - b) / 2));
-				out[out_plane * 2 + c] = (int16_t)(g - temp);
-				out[out_plane * 0 + c] = (int16_t)(temp + ((g - temp) / 2));
-			}
+				sToYuv(AKO_COLOR_YCOCG, out_plane, out + c);
 		}
 		else if (color == AKO_COLOR_YCOCG_Q)
 		{
 			for (size_t c = 0; c < (width * height); c++)
-			{
-				const int16_t r = out[out_plane * 0 + c];
-				const int16_t g = out[out_plane * 1 + c];
-				const int16_t b = out[out_plane * 2 + c];
-
-				out[out_plane * 1 + c] = (int16_t)(r - b);
-				const int16_t temp = (int16_t)(b + ((r - b) / 2));
-				out[out_plane * 2 + c] = (int16_t)(g - temp);
-				out[out_plane * 0 + c] = (int16_t)((temp + ((g - temp) / 2)) * 2);
-			}
+				sToYuv(AKO_COLOR_YCOCG_Q, out_plane, out + c);
 		}
 		else if (color == AKO_COLOR_SUBTRACT_G)
 		{
-			// https://developers.google.com/speed/webp/docs/compression#subtract_green_transform
 			for (size_t c = 0; c < (width * height); c++)
-			{
-				const int16_t r = out[out_plane * 0 + c];
-				const int16_t g = out[out_plane * 1 + c];
-				const int16_t b = out[out_plane * 2 + c];
-
-				out[out_plane * 0 + c] = (int16_t)(g);
-				out[out_plane * 1 + c] = (int16_t)(r - g);
-				out[out_plane * 2 + c] = (int16_t)(b - g);
-			}
+				sToYuv(AKO_COLOR_SUBTRACT_G, out_plane, out + c);
 		}
 	}
 }
@@ -229,83 +531,417 @@ static inline void sSaturateRgb(size_t channels, size_t width, size_t height, si
 }
 
 
-static inline void sInterleave(size_t channels, size_t width, size_t in_plane, size_t out_stride, const int16_t* in,
-                               uint8_t* out, const uint8_t* out_end)
+static inline void sInterleave(size_t channels, size_t out_pitch, size_t width, size_t in_stride, size_t in_plane,
+                               size_t out_stride, const int16_t* in, uint8_t* out, const uint8_t* out_end)
 {
-	for (; out < out_end; out += out_stride, in += width)
+	for (; out < out_end; out += out_stride, in += in_stride)
 		for (size_t col = 0; col < width; col++)
 		{
 			for (size_t ch = 0; ch < channels; ch++)
-				out[col * channels + ch] = (uint8_t)(in[in_plane * ch + col]);
+				out[col * out_pitch + ch] = (uint8_t)(in[in_plane * ch + col]);
 		}
 }
 
 
+static inline uint8_t sSaturate(int16_t v)
+{
+	return (uint8_t)((v > 0) ? (v < 255) ? v : 255 : 0);
+}
+
+static inline void sToRgbRow(enum akoColor color, size_t channels, size_t col, size_t width, size_t in_plane,
+                             const int16_t* in, uint8_t* out) // All above in one go, for kernels tails
+{
+	for (; col < width; col++)
+	{
+		size_t ch = 0;
+
+		if (channels >= 3 && color != AKO_COLOR_NONE)
+		{
+			int16_t y = in[in_plane * 0 + col];
+			const int16_t u = in[in_plane * 1 + col];
+			const int16_t v = in[in_plane * 2 + col];
+			int16_t r, g, b;
+
+			if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+			{
+				if (color == AKO_COLOR_YCOCG_Q)
+					y = (int16_t)(y / 2);
+
+				const int16_t temp = (int16_t)(y - (v / 2));
+				g = (int16_t)(v + temp);
+				b = (int16_t)(temp - (u / 2));
+				r = (int16_t)(b + u);
+			}
+			else
+			{
+				r = (int16_t)(u + y);
+				g = (int16_t)(y);
+				b = (int16_t)(v + y);
+			}
+
+			out[col * channels + 0] = sSaturate(r);
+			out[col * channels + 1] = sSaturate(g);
+			out[col * channels + 2] = sSaturate(b);
+			ch = 3;
+		}
+
+		for (; ch < channels; ch++)
+			out[col * channels + ch] = sSaturate(in[in_plane * ch + col]);
+	}
+}
+
+
+// Simd versions of above, color transformation, saturation and interleave
+// in one go, a row at time. Output pitch equals channels
+
+#if (AKO_SIMD_X86 == 1)
+static inline void sToRgbSse2(enum akoColor color, __m128i* a, __m128i* b, __m128i* c)
+{
+	const __m128i u = *b;
+	const __m128i v = *c;
+	__m128i y = *a;
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		if (color == AKO_COLOR_YCOCG_Q)
+			y = sHalfSse2(y);
+
+		const __m128i temp = _mm_sub_epi16(y, sHalfSse2(v));
+		const __m128i bl = _mm_sub_epi16(temp, sHalfSse2(u));
+
+		*a = _mm_add_epi16(bl, u);
+		*b = _mm_add_epi16(v, temp);
+		*c = bl;
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+	{
+		*a = _mm_add_epi16(u, y);
+		*b = y;
+		*c = _mm_add_epi16(v, y);
+	}
+}
+
+static inline size_t sYuvaToRgbaLoopSse2(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                         const int16_t* in, uint8_t* out)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(in + in_plane * 0 + c));
+		__m128i g = _mm_loadu_si128((const __m128i*)(in + in_plane * 1 + c));
+		__m128i b = _mm_loadu_si128((const __m128i*)(in + in_plane * 2 + c));
+		const __m128i a = _mm_loadu_si128((const __m128i*)(in + in_plane * 3 + c));
+
+		sToRgbSse2(color, &r, &g, &b);
+
+		// Packs saturate, unpacks interleave
+		const __m128i rb = _mm_packus_epi16(r, b);
+		const __m128i ga = _mm_packus_epi16(g, a);
+		const __m128i rg = _mm_unpacklo_epi8(rb, ga);
+		const __m128i ba = _mm_unpackhi_epi8(rb, ga);
+
+		_mm_storeu_si128((__m128i*)(out + c * 4), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*)(out + c * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+	}
+
+	return c;
+}
+
+static size_t sYuvaToRgbaSse2(enum akoColor color, size_t c, size_t end, size_t in_plane, const int16_t* in,
+                              uint8_t* out)
+{
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sYuvaToRgbaLoopSse2(AKO_COLOR_YCOCG, c, end, in_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sYuvaToRgbaLoopSse2(AKO_COLOR_YCOCG_Q, c, end, in_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sYuvaToRgbaLoopSse2(AKO_COLOR_SUBTRACT_G, c, end, in_plane, in, out);
+	default: return sYuvaToRgbaLoopSse2(AKO_COLOR_NONE, c, end, in_plane, in, out);
+	}
+}
+
+AKO_TARGET_SSE4_1 static inline size_t sYuvToRgbLoopSse4(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                                         const int16_t* in, uint8_t* out)
+{
+	// Eight pixels into 24 bytes, from red and blue packed together, and green
+	const __m128i rb_lo = _mm_setr_epi8(0, -1, 8, 1, -1, 9, 2, -1, 10, 3, -1, 11, 4, -1, 12, 5);
+	const __m128i g_lo = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+	const __m128i rb_hi = _mm_setr_epi8(-1, 13, 6, -1, 14, 7, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i g_hi = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	for (; c + 8 <= end; c += 8)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(in + in_plane * 0 + c));
+		__m128i g = _mm_loadu_si128((const __m128i*)(in + in_plane * 1 + c));
+		__m128i b = _mm_loadu_si128((const __m128i*)(in + in_plane * 2 + c));
+
+		sToRgbSse2(color, &r, &g, &b);
+
+		const __m128i rb = _mm_packus_epi16(r, b);
+		const __m128i gg = _mm_packus_epi16(g, g);
+
+		_mm_storeu_si128((__m128i*)(out + c * 3),
+		                 _mm_or_si128(_mm_shuffle_epi8(rb, rb_lo), _mm_shuffle_epi8(gg, g_lo)));
+		_mm_storel_epi64((__m128i*)(out + c * 3 + 16),
+		                 _mm_or_si128(_mm_shuffle_epi8(rb, rb_hi), _mm_shuffle_epi8(gg, g_hi)));
+	}
+
+	return c;
+}
+
+AKO_TARGET_SSE4_1 static size_t sYuvToRgbSse4(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                              const int16_t* in, uint8_t* out)
+{
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sYuvToRgbLoopSse4(AKO_COLOR_YCOCG, c, end, in_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sYuvToRgbLoopSse4(AKO_COLOR_YCOCG_Q, c, end, in_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sYuvToRgbLoopSse4(AKO_COLOR_SUBTRACT_G, c, end, in_plane, in, out);
+	default: return sYuvToRgbLoopSse4(AKO_COLOR_NONE, c, end, in_plane, in, out);
+	}
+}
+
+
+AKO_TARGET_AVX2 static inline void sToRgbAvx2(enum akoColor color, __m256i* a, __m256i* b, __m256i* c)
+{
+	const __m256i u = *b;
+	const __m256i v = *c;
+	__m256i y = *a;
+
+	if (color == AKO_COLOR_YCOCG || color == AKO_COLOR_YCOCG_Q)
+	{
+		if (color == AKO_COLOR_YCOCG_Q)
+			y = sHalfAvx2(y);
+
+		const __m256i temp = _mm256_sub_epi16(y, sHalfAvx2(v));
+		const __m256i bl = _mm256_sub_epi16(temp, sHalfAvx2(u));
+
+		*a = _mm256_add_epi16(bl, u);
+		*b = _mm256_add_epi16(v, temp);
+		*c = bl;
+	}
+	else if (color == AKO_COLOR_SUBTRACT_G)
+	{
+		*a = _mm256_add_epi16(u, y);
+		*b = y;
+		*c = _mm256_add_epi16(v, y);
+	}
+}
+
+AKO_TARGET_AVX2 static inline size_t sYuvaToRgbaLoopAvx2(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                                         const int16_t* in, uint8_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		__m256i r = _mm256_loadu_si256((const __m256i*)(in + in_plane * 0 + c));
+		__m256i g = _mm256_loadu_si256((const __m256i*)(in + in_plane * 1 + c));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(in + in_plane * 2 + c));
+		const __m256i a = _mm256_loadu_si256((const __m256i*)(in + in_plane * 3 + c));
+
+		sToRgbAvx2(color, &r, &g, &b);
+
+		// As Sse2, per 128 bits lane, permutes put pixels back in order
+		const __m256i rb = _mm256_packus_epi16(r, b);
+		const __m256i ga = _mm256_packus_epi16(g, a);
+		const __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+		const __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+		const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+		const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+
+		_mm256_storeu_si256((__m256i*)(out + c * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)(out + c * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	_mm256_zeroupper();
+	return sYuvaToRgbaSse2(color, c, end, in_plane, in, out);
+}
+
+AKO_TARGET_AVX2 static size_t sYuvaToRgbaAvx2(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                              const int16_t* in, uint8_t* out)
+{
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sYuvaToRgbaLoopAvx2(AKO_COLOR_YCOCG, c, end, in_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sYuvaToRgbaLoopAvx2(AKO_COLOR_YCOCG_Q, c, end, in_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sYuvaToRgbaLoopAvx2(AKO_COLOR_SUBTRACT_G, c, end, in_plane, in, out);
+	default: return sYuvaToRgbaLoopAvx2(AKO_COLOR_NONE, c, end, in_plane, in, out);
+	}
+}
+
+AKO_TARGET_AVX2 static inline size_t sYuvToRgbLoopAvx2(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                                       const int16_t* in, uint8_t* out)
+{
+	// As Sse4.1, with each 128 bits lane doing eight pixels
+	const __m256i rb_lo = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(0, -1, 8, 1, -1, 9, 2, -1, 10, 3, -1, 11, 4, -1, 12, 5));
+	const __m256i g_lo = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1));
+	const __m256i rb_hi = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(-1, 13, 6, -1, 14, 7, -1, 15, -1, -1, -1, -1, -1, -1, -1, -1));
+	const __m256i g_hi = _mm256_broadcastsi128_si256(
+	    _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+
+	for (; c + 16 <= end; c += 16)
+	{
+		__m256i r = _mm256_loadu_si256((const __m256i*)(in + in_plane * 0 + c));
+		__m256i g = _mm256_loadu_si256((const __m256i*)(in + in_plane * 1 + c));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(in + in_plane * 2 + c));
+
+		sToRgbAvx2(color, &r, &g, &b);
+
+		const __m256i rb = _mm256_packus_epi16(r, b);
+		const __m256i gg = _mm256_packus_epi16(g, g);
+		const __m256i lo = _mm256_or_si256(_mm256_shuffle_epi8(rb, rb_lo), _mm256_shuffle_epi8(gg, g_lo));
+		const __m256i hi = _mm256_or_si256(_mm256_shuffle_epi8(rb, rb_hi), _mm256_shuffle_epi8(gg, g_hi));
+
+		_mm_storeu_si128((__m128i*)(out + c * 3), _mm256_castsi256_si128(lo));
+		_mm_storel_epi64((__m128i*)(out + c * 3 + 16), _mm256_castsi256_si128(hi));
+		_mm_storeu_si128((__m128i*)(out + c * 3 + 24), _mm256_extracti128_si256(lo, 1));
+		_mm_storel_epi64((__m128i*)(out + c * 3 + 40), _mm256_extracti128_si256(hi, 1));
+	}
+
+	_mm256_zeroupper();
+	return sYuvToRgbSse4(color, c, end, in_plane, in, out);
+}
+
+AKO_TARGET_AVX2 static size_t sYuvToRgbAvx2(enum akoColor color, size_t c, size_t end, size_t in_plane,
+                                            const int16_t* in, uint8_t* out)
+{
+	switch (color)
+	{
+	case AKO_COLOR_YCOCG: return sYuvToRgbLoopAvx2(AKO_COLOR_YCOCG, c, end, in_plane, in, out);
+	case AKO_COLOR_YCOCG_Q: return sYuvToRgbLoopAvx2(AKO_COLOR_YCOCG_Q, c, end, in_plane, in, out);
+	case AKO_COLOR_SUBTRACT_G: return sYuvToRgbLoopAvx2(AKO_COLOR_SUBTRACT_G, c, end, in_plane, in, out);
+	default: return sYuvToRgbLoopAvx2(AKO_COLOR_NONE, c, end, in_plane, in, out);
+	}
+}
+#endif
+
+
 void akoFormatToInterleavedU8Rgb(enum akoColor color, size_t channels, size_t width, size_t height,
-                                 size_t in_planes_spacing, size_t output_stride, int16_t* in, uint8_t* out)
+                                 size_t in_planes_spacing, size_t region_x, size_t region_y, size_t region_w,
+                                 size_t region_h, size_t out_pitch, size_t out_stride, int16_t* in, uint8_t* out)
 {
-	// Color transformation (to Rgb) (destroys 'in')
+	// Only rows touched by the region get transformed, and from them
+	// only the region columns interleaved
+	const size_t in_plane = (width * height) + in_planes_spacing;
+	int16_t* in_region = in + width * region_y;
+
+	// Rgb(a), all in one go a row at time, with whatever kernels left for plain C
 	{
-		const size_t in_plane = (width * height) + in_planes_spacing;
+		const struct akoKernels* k = akoKernels();
+		size_t (*kernel)(enum akoColor, size_t, size_t, size_t, const int16_t*, uint8_t*) = NULL;
 
+		if (channels == 3 && out_pitch == 3)
+			kernel = k->format_yuv_to_rgb;
+		else if (channels == 4 && out_pitch == 4)
+			kernel = k->format_yuva_to_rgba;
+
+		if (kernel != NULL)
+		{
+			const uint8_t* out_end = out + out_stride * region_h;
+
+			for (in_region += region_x; out < out_end; out += out_stride, in_region += width)
+			{
+				const size_t col = kernel(color, 0, region_w, in_plane, in_region, out);
+				sToRgbRow(color, channels, col, region_w, in_plane, in_region, out);
+			}
+
+			return;
+		}
+	}
+
+	// Color transformation (to Rgb) (destroys 'in')
+	{
 		if (color == AKO_COLOR_YCOCG && channels >= 3)
 		{
 			if (channels == 3)
-				sYCoCgToRgb(3, width, height, in_plane, in);
+				sYCoCgToRgb(3, width, region_h, in_plane, in_region);
 			else if (channels == 4)
-				sYCoCgToRgb(4, width, height, in_plane, in);
+				sYCoCgToRgb(4, width, region_h, in_plane, in_region);
 			else
-				sYCoCgToRgb(channels, width, height, in_plane, in);
+				sYCoCgToRgb(channels, width, region_h, in_plane, in_region);
 		}
 		else if (color == AKO_COLOR_YCOCG_Q && channels >= 3)
 		{
 			if (channels == 3)
-				sYCoCgQToRgb(3, width, height, in_plane, in);
+				sYCoCgQToRgb(3, width, region_h, in_plane, in_region);
 			else if (channels == 4)
-				sYCoCgQToRgb(4, width, height, in_plane, in);
+				sYCoCgQToRgb(4, width, region_h, in_plane, in_region);
 			else
-				sYCoCgQToRgb(channels, width, height, in_plane, in);
+				sYCoCgQToRgb(channels, width, region_h, in_plane, in_region);
 		}
 		else if (color == AKO_COLOR_SUBTRACT_G && channels >= 3)
 		{
 			if (channels == 3)
-				sSubtractGToRgb(3, width, height, in_plane, in);
+				sSubtractGToRgb(3, width, region_h, in_plane, in_region);
 			else if (channels == 4)
-				sSubtractGToRgb(4, width, height, in_plane, in);
+				sSubtractGToRgb(4, width, region_h, in_plane, in_region);
 			else
-				sSubtractGToRgb(channels, width, height, in_plane, in);
+				sSubtractGToRgb(channels, width, region_h, in_plane, in_region);
 		}
 		else
 		{
 			if (channels == 3)
-				sSaturateRgb(3, width, height, in_plane, in);
+				sSaturateRgb(3, width, region_h, in_plane, in_region);
 			else if (channels == 4)
-				sSaturateRgb(4, width, height, in_plane, in);
+				sSaturateRgb(4, width, region_h, in_plane, in_region);
 			else if (channels == 2)
-				sSaturateRgb(2, width, height, in_plane, in);
+				sSaturateRgb(2, width, region_h, in_plane, in_region);
 			else if (channels == 1)
-				sSaturateRgb(1, width, height, in_plane, in);
+				sSaturateRgb(1, width, region_h, in_plane, in_region);
 			else
-				sSaturateRgb(channels, width, height, in_plane, in);
+				sSaturateRgb(channels, width, region_h, in_plane, in_region);
 		}
 	}
 
 	// Interleave and convert from i16 to u8
+	// (bytes between pixels, if any, are left untouched)
 	{
-		const size_t in_plane = (width * height) + in_planes_spacing;
+		const uint8_t* out_end = out + out_stride * region_h;
+
+		in_region += region_x;
+
+		if (channels == 3 && out_pitch == 3)
+			sInterleave(3, 3, region_w, width, in_plane, out_stride, in_region, out, out_end);
+		else if (channels == 4 && out_pitch == 4)
+			sInterleave(4, 4, region_w, width, in_plane, out_stride, in_region, out, out_end);
+		else if (channels == 2 && out_pitch == 2)
+			sInterleave(2, 2, region_w, width, in_plane, out_stride, in_region, out, out_end);
+		else if (channels == 1 && out_pitch == 1)
+			sInterleave(1, 1, region_w, width, in_plane, out_stride, in_region, out, out_end);
+		else
+			sInterleave(channels, out_pitch, region_w, width, in_plane, out_stride, in_region, out, out_end);
+	}
+}
 
-		const size_t out_stride = output_stride * channels;
-		const uint8_t* out_end = out + out_stride * height;
 
-		if (channels == 3)
-			sInterleave(3, width, in_plane, out_stride, in, out, out_end);
-		else if (channels == 4)
-			sInterleave(4, width, in_plane, out_stride, in, out, out_end);
-		else if (channels == 2)
-			sInterleave(2, width, in_plane, out_stride, in, out, out_end);
-		else if (channels == 1)
-			sInterleave(1, width, in_plane, out_stride, in, out, out_end);
-		else
-			sInterleave(channels, width, in_plane, out_stride, in, out, out_end);
+void akoFormatKernels(enum akoSimd simd, struct akoKernels* k)
+{
+	k->format_rgb_to_yuv = NULL;
+	k->format_rgba_to_yuv = NULL;
+	k->format_yuv_to_rgb = NULL;
+	k->format_yuva_to_rgba = NULL;
+
+#if (AKO_SIMD_X86 == 1)
+	if (simd >= AKO_SIMD_SSE2)
+	{
+		k->format_rgba_to_yuv = sRgbaToYuvSse2;
+		k->format_yuva_to_rgba = sYuvaToRgbaSse2;
+	}
+
+	if (simd >= AKO_SIMD_SSE4_1)
+	{
+		k->format_rgb_to_yuv = sRgbToYuvSse4;
+		k->format_yuv_to_rgb = sYuvToRgbSse4;
+	}
+
+	if (simd >= AKO_SIMD_AVX2)
+	{
+		k->format_rgb_to_yuv = sRgbToYuvAvx2;
+		k->format_rgba_to_yuv = sRgbaToYuvAvx2;
+		k->format_yuv_to_rgb = sYuvToRgbAvx2;
+		k->format_yuva_to_rgba = sYuvaToRgbaAvx2;
 	}
+#else
+	(void)simd;
+#endif
 }
@@ -103,6 +103,7 @@ enum akoStatus akoHeadWrite(size_t channels, size_t width, size_t height, const
 	h->flags |= (uint32_t)(s->color) << 8;
 	h->flags |= (uint32_t)(s->compression) << 10;
 	h->flags |= (uint32_t)(binary_tiles_dimension) << 12;
+	h->flags |= (uint32_t)((s->tiles_index != 0) ? 1 : 0) << 17;
 
 	// Bye!
 	return AKO_OK;
@@ -121,7 +122,7 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 	if (h->version != AKO_FORMAT_VERSION)
 		return AKO_UNSUPPORTED_VERSION;
 
-	if ((h->flags >> 15) != 0)
+	if ((h->flags >> 18) != 0)
 		return AKO_INVALID_FLAGS;
 
 	const size_t channels = (size_t)((h->flags & 0x000F)) + 1;
@@ -129,6 +130,7 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 	const enum akoWavelet wavelet = (enum akoWavelet)((h->flags >> 6) & 0x0003);
 	const enum akoColor color = (enum akoColor)((h->flags >> 8) & 0x0003);
 	const enum akoCompression compression = (enum akoCompression)((h->flags >> 10) & 0x0003);
+	const int tiles_index = (int)((h->flags >> 17) & 0x0001);
 
 	size_t tiles_dimension = ((h->flags >> 12) & 0x001F);
 	if (tiles_dimension != 0)
@@ -162,8 +164,36 @@ enum akoStatus akoHeadRead(const void* in, size_t* out_channels, size_t* out_wid
 		out_s->color = color;
 		out_s->compression = compression;
 		out_s->tiles_dimension = tiles_dimension;
+		out_s->tiles_index = tiles_index;
 	}
 
 	// Bye!
 	return AKO_OK;
 }
+
+
+size_t akoIndexSize(size_t tiles_no)
+{
+	return tiles_no * sizeof(uint64_t);
+}
+
+
+void akoIndexWrite(size_t tile_no, size_t offset, void* index)
+{
+	uint8_t* out = (uint8_t*)index + tile_no * sizeof(uint64_t);
+
+	for (size_t i = 0; i < sizeof(uint64_t); i++)
+		out[i] = (uint8_t)(((uint64_t)offset >> (i * 8)) & 0xFF);
+}
+
+
+size_t akoIndexRead(size_t tile_no, const void* index)
+{
+	const uint8_t* in = (const uint8_t*)index + tile_no * sizeof(uint64_t);
+	uint64_t offset = 0;
+
+	for (size_t i = 0; i < sizeof(uint64_t); i++)
+		offset |= (uint64_t)(in[i]) << (i * 8);
+
+	return (size_t)offset;
+}
@@ -34,15 +34,12 @@ SOFTWARE.
 #define RLE_TRIGGER_LEN 2 // Number of identical consecutive values to activate RLE
 #define ELIAS_ACCUMULATOR_FILL_AT 32
 
+#define ENCODE_BLOCK_LEN 256                                    // Values per output end check
+#define ENCODE_BLOCK_WORST ((ENCODE_BLOCK_LEN + 1) * 5 + 8 + 8) // In bytes, see akoKagariEncode()
 
-static inline int sBitsLen(uint16_t v)
-{
-	int len = 0;
-	for (; v > 1; v >>= 1)
-		len++;
+#define GOLOMB_MAX_K 15        // Exp-Golomb parameter, per band
+#define GOLOMB_SAMPLE_FROM 256 // Band length where sGolombParameter() starts sampling
 
-	return len;
-}
 
 static inline int sLeadingZeros(uint32_t v)
 {
@@ -55,11 +52,27 @@ static inline int sLeadingZeros(uint32_t v)
 	//	return len;
 }
 
+static inline int sBitsLen(uint32_t v)
+{
+	return 31 - sLeadingZeros(v | 1); // Or-ed as zero has no leading one
 
-int akoEliasEncodeStep(struct akoEliasState* s, uint16_t v, uint8_t** cursor, const uint8_t* end)
+	//	int len = 0;
+	//	for (; v > 1; v >>= 1)
+	//		len++;
+
+	//	return len;
+}
+
+
+// Exp-Golomb of order 'k' codes 'v' as Elias gamma codes 'v + (1 << k)', minus the 'k'
+// unary bits that always lead. Order zero being Elias gamma itself. So functions below
+// take 'w' (that is, 'v + (1 << k)', never zero) rather than 'v'
+
+static int sGolombEncodeStepChecked(struct akoEliasState* s, int k, uint32_t w, uint8_t** cursor,
+                                    const uint8_t* end)
 {
-	const int binary_bits = sBitsLen(v);
-	const int total_bits = binary_bits * 2 + 1;
+	const int binary_bits = sBitsLen(w);
+	const int total_bits = binary_bits * 2 - k + 1;
 
 	// Make space
 	if (s->accumulator_usage > 8 && s->accumulator_usage + total_bits > AKO_ELIAS_ACCUMULATOR_LEN)
@@ -80,12 +93,17 @@ int akoEliasEncodeStep(struct akoEliasState* s, uint16_t v, uint8_t** cursor, co
 
 	// Encode
 	s->accumulator <<= total_bits; // Unary part
-	s->accumulator |= (uint64_t)v; // Binary part (implicit stop mark)
+	s->accumulator |= (uint64_t)w; // Binary part (implicit stop mark)
 
 	// Bye!
 	return total_bits;
 }
 
+int akoEliasEncodeStep(struct akoEliasState* s, uint16_t v, uint8_t** cursor, const uint8_t* end)
+{
+	return sGolombEncodeStepChecked(s, 0, v, cursor, end);
+}
+
 
 size_t akoEliasEncodeEnd(struct akoEliasState* s, uint8_t** cursor, const uint8_t* end, void* out_start)
 {
@@ -116,7 +134,8 @@ size_t akoEliasEncodeEnd(struct akoEliasState* s, uint8_t** cursor, const uint8_
 }
 
 
-uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, const uint8_t* end, int* out_bits)
+static uint32_t sGolombDecodeStepCareful(struct akoEliasState* s, int k, const uint8_t** cursor,
+                                         const uint8_t* end, int* out_bits)
 {
 	// Fill accumulator
 	if (s->accumulator == 0 || s->accumulator_usage < (AKO_ELIAS_ACCUMULATOR_LEN - ELIAS_ACCUMULATOR_FILL_AT))
@@ -146,14 +165,18 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 	}
 
 	// Decode
-	const int unary_bits = sLeadingZeros((uint32_t)(s->accumulator >> ELIAS_ACCUMULATOR_FILL_AT));
-	const int total_bits = unary_bits * 2 + 1;
+	const uint32_t head = (uint32_t)(s->accumulator >> ELIAS_ACCUMULATOR_FILL_AT);
+	if (head == 0)
+		return 0;
+
+	const int unary_bits = sLeadingZeros(head);
+	const int total_bits = unary_bits * 2 + k + 1;
 
 	if (total_bits > s->accumulator_usage)
 		return 0;
 
 	*out_bits = total_bits;
-	const uint16_t value = (uint16_t)(s->accumulator >> (AKO_ELIAS_ACCUMULATOR_LEN - total_bits));
+	const uint32_t value = (uint32_t)(s->accumulator >> (AKO_ELIAS_ACCUMULATOR_LEN - total_bits));
 
 	s->accumulator <<= total_bits;
 	s->accumulator_usage -= total_bits;
@@ -162,6 +185,11 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 	return value;
 }
 
+uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, const uint8_t* end, int* out_bits)
+{
+	return (uint16_t)sGolombDecodeStepCareful(s, 0, cursor, end, out_bits);
+}
+
 
 //
 
@@ -169,7 +197,7 @@ uint16_t akoEliasDecodeStep(struct akoEliasState* s, const uint8_t** cursor, con
 static inline uint16_t sZigZagEncode(int16_t in)
 {
 	// https://developers.google.com/protocol-buffers/docs/encoding#signed_integers
-	return (uint16_t)((in << 1) ^ (in >> 15));
+	return (uint16_t)(((uint16_t)in << 1) ^ (in >> 15));
 }
 
 static inline int16_t sZigZagDecode(uint16_t in)
@@ -196,109 +224,312 @@ static inline void sRawWriteMultipleValues(int16_t value, uint16_t rle_len, int1
 }
 
 
-static inline int sEncodeRle(struct akoEliasState* elias, uint8_t** cursor, const uint8_t* end, uint16_t consecutive_no)
+static inline void sStoreBigEndian64(uint64_t v, uint8_t* out)
 {
-	return akoEliasEncodeStep(elias, (uint16_t)(consecutive_no - RLE_TRIGGER_LEN + 1), // +1 as elias can't encode zero
-	                          cursor, end);
+	v = __builtin_bswap64(v);
+	__builtin_memcpy(out, &v, sizeof(uint64_t));
 }
 
-static inline int sDecodeRle(struct akoEliasState* elias, const uint8_t** cursor, const uint8_t* end, uint16_t* out)
+static inline void sGolombEncodeStep(struct akoEliasState* s, int k, uint32_t w, uint8_t** cursor)
 {
-	int bits = 0;
-	*out = akoEliasDecodeStep(elias, cursor, end, &bits) - 1; // -1 to compensate that elias can't encode zero
+	// Same as sGolombEncodeStepChecked(), without checking the output end (caller does, per
+	// block) and flushing all whole bytes with one store. Bytes after those stored are
+	// garbage, to be overwritten in the next flush or by akoEliasEncodeEnd()
+	const int total_bits = sBitsLen(w) * 2 - k + 1;
 
-	return bits;
+	if (s->accumulator_usage + total_bits > AKO_ELIAS_ACCUMULATOR_LEN)
+	{
+		sStoreBigEndian64(s->accumulator << (AKO_ELIAS_ACCUMULATOR_LEN - s->accumulator_usage), *cursor);
+		*cursor = *cursor + (s->accumulator_usage / 8);
+		s->accumulator_usage %= 8;
+	}
+
+	s->accumulator_usage += total_bits;
+	s->accumulator <<= total_bits;
+	s->accumulator |= (uint64_t)w;
 }
 
 
-static inline int sEncodeValue(struct akoEliasState* elias, uint8_t** cursor, const uint8_t* end, int16_t value)
+static inline int sEncodeRle(int checked, struct akoEliasState* elias, uint8_t** cursor, const uint8_t* end,
+                             uint16_t consecutive_no)
+{
+	const uint16_t v = (uint16_t)(consecutive_no - RLE_TRIGGER_LEN + 1); // +1 as elias can't encode zero
+
+	if (checked != 0)
+		return akoEliasEncodeStep(elias, v, cursor, end);
+
+	sGolombEncodeStep(elias, 0, v, cursor);
+	return 1;
+}
+
+static inline uint64_t sLoadBigEndian64(const uint8_t* in)
 {
-	return akoEliasEncodeStep(elias, sZigZagEncode(value) + 1, cursor, end);
+	uint64_t v;
+	__builtin_memcpy(&v, in, sizeof(uint64_t));
+	return __builtin_bswap64(v);
 }
 
-static inline int sDecodeValue(struct akoEliasState* elias, const uint8_t** cursor, const uint8_t* end, int16_t* out)
+static inline uint32_t sGolombDecodeStep(struct akoEliasState* s, int k, const uint8_t** cursor, const uint8_t* end,
+                                         int* out_bits)
+{
+	// Same as sGolombDecodeStepCareful(), but filling the accumulator with one load rather than
+	// byte by byte. Reads the same bytes, those that fit whole; bits of the one that doesn't
+	// fit end under the usage mark, to get Or-ed again (being equal) in the next fill
+	if (s->accumulator == 0 || s->accumulator_usage < (AKO_ELIAS_ACCUMULATOR_LEN - ELIAS_ACCUMULATOR_FILL_AT))
+	{
+		if (*cursor + 8 > end)
+			return sGolombDecodeStepCareful(s, k, cursor, end, out_bits); // Near the input end
+
+		const int bytes = (AKO_ELIAS_ACCUMULATOR_LEN - 1 - s->accumulator_usage) / 8;
+
+		s->accumulator |= sLoadBigEndian64(*cursor) >> s->accumulator_usage;
+		s->accumulator_usage += bytes * 8;
+		*cursor = *cursor + bytes;
+	}
+
+	// Decode, codes are never longer than 33 bits (a zigzag of 16 bits plus an order
+	// zero), so unary parts always fit in the head
+	const uint32_t head = (uint32_t)(s->accumulator >> ELIAS_ACCUMULATOR_FILL_AT);
+	if (head == 0)
+		return 0;
+
+	const int total_bits = sLeadingZeros(head) * 2 + k + 1;
+	if (total_bits > s->accumulator_usage)
+		return 0;
+
+	*out_bits = total_bits;
+	const uint32_t value = (uint32_t)(s->accumulator >> (AKO_ELIAS_ACCUMULATOR_LEN - total_bits));
+
+	s->accumulator <<= total_bits;
+	s->accumulator_usage -= total_bits;
+
+	return value;
+}
+
+
+static inline int sDecodeRle(struct akoEliasState* elias, const uint8_t** cursor, const uint8_t* end, uint16_t* out)
 {
 	int bits = 0;
-	*out = sZigZagDecode((akoEliasDecodeStep(elias, cursor, end, &bits) - 1));
+	*out = (uint16_t)(sGolombDecodeStep(elias, 0, cursor, end, &bits) - 1); // -1 as elias can't encode zero
 
 	return bits;
 }
 
 
-size_t akoKagariEncode(size_t input_size, size_t output_size, const void* input, void* output)
+static inline int sEncodeValue(int checked, int k, struct akoEliasState* elias, uint8_t** cursor, const uint8_t* end,
+                               int16_t value)
 {
-	struct akoEliasState elias = {0};
+	const uint32_t w = (uint32_t)sZigZagEncode(value) + (1U << k);
 
-	const int16_t* input_end = (const int16_t*)((const uint8_t*)input + input_size);
-	const int16_t* in = (const int16_t*)input;
+	if (checked != 0)
+		return sGolombEncodeStepChecked(elias, k, w, cursor, end);
 
-	const uint8_t* out_end = (uint8_t*)output + output_size;
-	uint8_t* out = output;
-
-	uint16_t consecutive_no = 0;
-	int16_t previous_value = 0;
+	sGolombEncodeStep(elias, k, w, cursor);
+	return 1;
+}
 
-	if (output_size == 0 || input_size == 0)
-		return 0;
-	if ((input_size % 2) != 0)
-		return 0;
+static inline int sDecodeValue(int k, struct akoEliasState* elias, const uint8_t** cursor, const uint8_t* end,
+                               int16_t* out)
+{
+	int bits = 0;
+	*out = sZigZagDecode((uint16_t)(sGolombDecodeStep(elias, k, cursor, end, &bits) - (1U << k)));
 
-	// First value
-	if (sEncodeValue(&elias, &out, out_end, *in) == 0)
-		return 0;
+	return bits;
+}
 
-	previous_value = *in;
-	in++;
 
-	// All others
-	for (; in < input_end; in++)
+static inline int sEncodeBlock(int checked, int k, struct akoEliasState* elias, uint8_t** cursor, const uint8_t* end,
+                               const int16_t* in, const int16_t* in_end, uint16_t* consecutive_no,
+                               int16_t* previous_value)
+{
+	for (; in < in_end; in++)
 	{
-		if (*in == previous_value)
+		if (*in == *previous_value)
 		{
-			consecutive_no++;
+			*consecutive_no = *consecutive_no + 1;
 
-			if (consecutive_no <= RLE_TRIGGER_LEN)
+			if (*consecutive_no <= RLE_TRIGGER_LEN)
 			{
-				if (sEncodeValue(&elias, &out, out_end, *in) == 0)
+				if (sEncodeValue(checked, k, elias, cursor, end, *in) == 0)
 					return 0;
 			}
-			else if (consecutive_no == AKO_ELIAS_MAX - 1) // Oh no, at this rate we are going to overflow!
+			else if (*consecutive_no == AKO_ELIAS_MAX - 1) // Oh no, at this rate we are going to overflow!
 			{
-				if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+				if (sEncodeRle(checked, elias, cursor, end, *consecutive_no) == 0)
 					return 0;
 
-				consecutive_no = 0;
+				*consecutive_no = 0;
 			}
 		}
 		else
 		{
-			if (consecutive_no >= RLE_TRIGGER_LEN)
+			if (*consecutive_no >= RLE_TRIGGER_LEN)
 			{
-				if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+				if (sEncodeRle(checked, elias, cursor, end, *consecutive_no) == 0)
 					return 0;
 			}
 
-			if (sEncodeValue(&elias, &out, out_end, *in) == 0)
+			if (sEncodeValue(checked, k, elias, cursor, end, *in) == 0)
 				return 0;
 
-			previous_value = *in;
-			consecutive_no = 0;
+			*previous_value = *in;
+			*consecutive_no = 0;
 		}
 	}
 
-	// Maybe the loop finished with a pending Rle length to emit
-	if (consecutive_no >= RLE_TRIGGER_LEN)
+	return 1;
+}
+
+
+static size_t sBands(enum akoWavelet wavelet, size_t channels, size_t tile_w, size_t tile_h, size_t* out_dimensions,
+                     size_t* out_lifts)
+{
+	// Bands as lifting lays them: all lowpasses, then from the coarsest lift to the
+	// finest, for each channel, three highpasses. Lift heads go along the first one.
+	// Dimensions are of the tile (index zero) and then of every lift
+	size_t lifts = 0;
+	out_dimensions[0] = tile_w * tile_h;
+
+	// No wavelet, no lifts, the whole tile as a single band (of one channel)
+	if (wavelet == AKO_WAVELET_NONE)
+	{
+		out_dimensions[0] = tile_w * tile_h * channels;
+		*out_lifts = 0;
+		return 1;
+	}
+
+	while (tile_w > 2 && tile_h > 2)
+	{
+		tile_w = akoDividePlusOneRule(tile_w);
+		tile_h = akoDividePlusOneRule(tile_h);
+		out_dimensions[++lifts] = tile_w * tile_h;
+	}
+
+	*out_lifts = lifts;
+	return channels * (1 + lifts * 3);
+}
+
+static size_t sBandLength(size_t band, size_t channels, size_t lifts, const size_t* dimensions)
+{
+	if (band < channels)
+		return dimensions[lifts]; // Lowpass
+
+	const size_t lift = lifts - (band - channels) / (channels * 3);
+
+	if ((band - channels) % 3 == 0)
+		return dimensions[lift] + sizeof(struct akoLiftHead) / sizeof(int16_t);
+
+	return dimensions[lift];
+}
+
+
+static int sGolombParameter(const int16_t* in, const int16_t* in_end)
+{
+	// Histogram of values lengths, where the Exp-Golomb order with the lowest total
+	// wins. Is an estimation: on big bands only a quarter of values are sampled, values
+	// in Rle runs count as any other, and codes of values a bit below the next power
+	// of two are two bits longer than counted here. Leaving runs out, in practice,
+	// chooses worse
+	const size_t len = (size_t)(in_end - in);
+	const size_t step = (len >= GOLOMB_SAMPLE_FROM) ? 4 : 1;
+	uint32_t histogram[17] = {0};
+
+	for (size_t i = 0; i < len; i += step)
+		histogram[sBitsLen((uint32_t)sZigZagEncode(in[i]) + 1)] += 1;
+
+	int best_k = 0;
+	size_t best_bits = SIZE_MAX;
+
+	for (int k = 0; k <= GOLOMB_MAX_K; k++)
+	{
+		size_t bits = 0;
+		for (int b = 0; b < 17; b++)
+			bits += (size_t)histogram[b] * (size_t)((b < k) ? (k + 1) : (b * 2 - k + 1));
+
+		if (bits < best_bits)
+		{
+			best_bits = bits;
+			best_k = k;
+		}
+	}
+
+	return best_k;
+}
+
+
+size_t akoKagariEncode(enum akoWavelet wavelet, size_t channels, size_t tile_w, size_t tile_h, size_t input_size,
+                       size_t output_size, const void* input, void* output)
+{
+	struct akoEliasState elias = {0};
+
+	const int16_t* input_end = (const int16_t*)((const uint8_t*)input + input_size);
+	const int16_t* in = (const int16_t*)input;
+
+	const uint8_t* out_end = (uint8_t*)output + output_size;
+	uint8_t* out = output;
+
+	uint16_t consecutive_no = 0;
+	int16_t previous_value = 0;
+
+	size_t dimensions[AKO_MAX_LIFTS + 1];
+	size_t lifts = 0;
+
+	if (output_size == 0 || input_size == 0)
+		return 0;
+	if ((input_size % 2) != 0)
+		return 0;
+
+	const size_t bands_no = sBands(wavelet, channels, tile_w, tile_h, dimensions, &lifts);
+
+	for (size_t b = 0; b < bands_no; b++)
 	{
-		if (sEncodeRle(&elias, &out, out_end, consecutive_no) == 0)
+		const int16_t* band_end = in + sBandLength(b, channels, lifts, dimensions);
+		if (band_end > input_end)
+			return 0;
+
+		// Band Exp-Golomb order first, and no Rle runs from previous bands
+		const int k = sGolombParameter(in, band_end);
+		if (akoEliasEncodeStep(&elias, (uint16_t)(k + 1), &out, out_end) == 0)
 			return 0;
+
+		consecutive_no = 0;
+
+		// Values, in blocks. Those far from the output end don't need to check it, far
+		// meaning: 33 bits per code, a code per value plus an Rle length that may come from
+		// the previous block (lengths otherwise take the place of values), 64 bits left in
+		// the accumulator and the 8 bytes a flush stores
+		while (in < band_end)
+		{
+			const int16_t* block_end =
+			    ((size_t)(band_end - in) > ENCODE_BLOCK_LEN) ? (in + ENCODE_BLOCK_LEN) : band_end;
+
+			if ((size_t)(out_end - out) >= ENCODE_BLOCK_WORST)
+				sEncodeBlock(0, k, &elias, &out, out_end, in, block_end, &consecutive_no, &previous_value);
+			else if (sEncodeBlock(1, k, &elias, &out, out_end, in, block_end, &consecutive_no, &previous_value) ==
+			         0)
+				return 0;
+
+			in = block_end;
+		}
+
+		// Maybe the loop finished with a pending Rle length to emit
+		if (consecutive_no >= RLE_TRIGGER_LEN)
+		{
+			if (sEncodeRle(1, &elias, &out, out_end, consecutive_no) == 0)
+				return 0;
+		}
 	}
 
+	if (in != input_end)
+		return 0;
+
 	// Bye!
 	return akoEliasEncodeEnd(&elias, &out, out_end, output);
 }
 
 
-size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output)
+size_t akoKagariDecode(enum akoWavelet wavelet, size_t channels, size_t tile_w, size_t tile_h, size_t no,
+                       size_t input_size, size_t output_size, const void* input, void* output)
 {
 	struct akoEliasState elias = {0};
 
@@ -312,53 +543,66 @@ size_t akoKagariDecode(size_t no, size_t input_size, size_t output_size, const v
 	int16_t previous_value = 0;
 	int16_t decoded_v = 0;
 
+	size_t dimensions[AKO_MAX_LIFTS + 1];
+	size_t lifts = 0;
+
 	if (output_size == 0 || input_size == 0 || no == 0)
 		return 0;
 	if ((output_size % 2) != 0)
 		return 0;
 
-	// First value
-	if (sDecodeValue(&elias, &in, in_end, &decoded_v) == 0)
-		return 0;
-
-	sRawWriteValue(decoded_v, &out);
-	previous_value = decoded_v;
-	no--;
+	const size_t bands_no = sBands(wavelet, channels, tile_w, tile_h, dimensions, &lifts);
 
-	// All others
-	for (; no != 0; no--)
+	for (size_t b = 0; b < bands_no && no != 0; b++)
 	{
-		if (out == out_end)
+		// When decoding just a prefix, it may end in the middle of a band
+		size_t len = sBandLength(b, channels, lifts, dimensions);
+		const int cut = (len > no) ? 1 : 0;
+		if (cut != 0)
+			len = no;
+
+		if ((size_t)(out_end - out) < len)
 			return 0;
 
-		if (sDecodeValue(&elias, &in, in_end, &decoded_v) == 0)
+		no -= len;
+
+		// Band Exp-Golomb order
+		int bits = 0;
+		const int k = (int)sGolombDecodeStep(&elias, 0, &in, in_end, &bits) - 1;
+
+		if (k < 0 || k > GOLOMB_MAX_K)
 			return 0;
 
-		if (decoded_v == previous_value)
+		consecutive_no = 0;
+
+		// Values
+		for (; len != 0; len--)
 		{
+			if (sDecodeValue(k, &elias, &in, in_end, &decoded_v) == 0)
+				return 0;
+
+			// Without branching on it, equal or not is hard to predict
+			consecutive_no = (decoded_v == previous_value) ? (uint16_t)(consecutive_no + 1) : 0;
+			previous_value = decoded_v;
 			sRawWriteValue(decoded_v, &out);
-			consecutive_no++;
 
 			if (consecutive_no == RLE_TRIGGER_LEN)
 			{
 				if (sDecodeRle(&elias, &in, in_end, &consecutive_no) == 0)
 					return 0;
 
-				const uint16_t rle_len = consecutive_no;
-				if ((out + (size_t)rle_len) > out_end)
+				// Runs never go beyond bands, those that do are broken input. Unless
+				// the band got cut to decode a prefix, then they go beyond the cut
+				if (consecutive_no >= len && cut == 0)
 					return 0;
 
+				const uint16_t rle_len = (consecutive_no < len) ? consecutive_no : (uint16_t)(len - 1);
+
 				sRawWriteMultipleValues(previous_value, rle_len, &out);
 				consecutive_no = 0;
-				no -= rle_len;
+				len -= rle_len;
 			}
 		}
-		else
-		{
-			sRawWriteValue(decoded_v, &out);
-			previous_value = decoded_v;
-			consecutive_no = 0;
-		}
 	}
 
 	// Bye!
@@ -26,17 +26,83 @@ SOFTWARE.
 
 #include "ako-private.h"
 
+#if (AKO_SIMD_X86 == 1)
+#include <immintrin.h>
+#endif
 
-static void sInverseQuantization(int16_t q, size_t w, size_t h, int16_t* inout)
+
+static inline int16_t sDivide(int16_t n, const struct akoReciprocal* q) // As 'n / q', truncating
 {
-	if (q <= 1)
-		return;
+	int16_t t = (int16_t)((n * q->mul) >> 16);
+	if (q->add != 0)
+		t = (int16_t)(t + n);
 
-	for (size_t r = 0; r < h; r++)
+	return (int16_t)((t >> q->shift) + ((n < 0) ? 1 : 0));
+}
+
+
+#if (AKO_SIMD_X86 == 1)
+static size_t sQuantizeSse2(size_t c, size_t end, const struct akoReciprocal* q, int16_t g, const int16_t* in,
+                            int16_t* out)
+{
+	const __m128i mul = _mm_set1_epi16(q->mul);
+	const __m128i add = _mm_set1_epi16((q->add != 0) ? -1 : 0);
+	const __m128i shift = _mm_cvtsi32_si128(q->shift);
+	const __m128i g_v = _mm_set1_epi16(g);
+	const __m128i neg_g_v = _mm_set1_epi16((int16_t)(-g));
+
+	for (; c + 8 <= end; c += 8)
 	{
-		for (size_t c = 0; c < w; c++)
-			inout[(r * w) + c] = inout[(r * w) + c] * q;
+		const __m128i v = _mm_loadu_si128((const __m128i*)(in + c));
+
+		__m128i t = _mm_add_epi16(_mm_mulhi_epi16(v, mul), _mm_and_si128(v, add));
+		t = _mm_add_epi16(_mm_sra_epi16(t, shift), _mm_srli_epi16(v, 15));
+
+		const __m128i gate = _mm_or_si128(_mm_cmpgt_epi16(v, g_v), _mm_cmplt_epi16(v, neg_g_v));
+		_mm_storeu_si128((__m128i*)(out + c), _mm_and_si128(gate, t));
 	}
+
+	return c;
+}
+
+AKO_TARGET_AVX2 static size_t sQuantizeAvx2(size_t c, size_t end, const struct akoReciprocal* q, int16_t g,
+                                            const int16_t* in, int16_t* out)
+{
+	const __m256i mul = _mm256_set1_epi16(q->mul);
+	const __m256i add = _mm256_set1_epi16((q->add != 0) ? -1 : 0);
+	const __m128i shift = _mm_cvtsi32_si128(q->shift);
+	const __m256i g_v = _mm256_set1_epi16(g);
+	const __m256i neg_g_v = _mm256_set1_epi16((int16_t)(-g));
+
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i v = _mm256_loadu_si256((const __m256i*)(in + c));
+
+		__m256i t = _mm256_add_epi16(_mm256_mulhi_epi16(v, mul), _mm256_and_si256(v, add));
+		t = _mm256_add_epi16(_mm256_sra_epi16(t, shift), _mm256_srli_epi16(v, 15));
+
+		const __m256i gate = _mm256_or_si256(_mm256_cmpgt_epi16(v, g_v), _mm256_cmpgt_epi16(neg_g_v, v));
+		_mm256_storeu_si256((__m256i*)(out + c), _mm256_and_si256(gate, t));
+	}
+
+	_mm256_zeroupper();
+	return sQuantizeSse2(c, end, q, g, in, out);
+}
+#endif
+
+
+void akoLiftingKernels(enum akoSimd simd, struct akoKernels* k)
+{
+	k->quantize = NULL;
+
+#if (AKO_SIMD_X86 == 1)
+	if (simd >= AKO_SIMD_SSE2)
+		k->quantize = sQuantizeSse2;
+	if (simd >= AKO_SIMD_AVX2)
+		k->quantize = sQuantizeAvx2;
+#else
+	(void)simd;
+#endif
 }
 
 
@@ -81,6 +147,9 @@ struct akoUnliftCallbackData
 	coeff_t* out;
 	size_t out_planes_space;
 	size_t tile_no;
+
+	size_t stop_w; // Lifts beyond these dimensions are skipped
+	size_t stop_h;
 };
 
 static void s2dUnliftLp(const struct akoSettings* s, size_t ch, size_t tile_w, size_t tile_h, size_t lp_w, size_t lp_h,
@@ -111,22 +180,24 @@ static void s2dUnliftHp(const struct akoSettings* s, size_t ch, size_t tile_w, s
 	const size_t ignore_last_col = (hp_w * 2) - target_w;
 	const size_t ignore_last_row = (hp_h * 2) - target_h;
 
-	sInverseQuantization(head->quantization, hp_w, hp_h, hp_b);
-	sInverseQuantization(head->quantization, hp_w, hp_h, hp_c);
-	sInverseQuantization(head->quantization, hp_w, hp_h, hp_d);
+	if (target_w > data->stop_w || target_h > data->stop_h)
+		return;
+
+	// Highpasses get inverse quantized as vertical unlifts read them
+	const int16_t q = (head->quantization > 1) ? head->quantization : 1;
 
 	if (s->wavelet == AKO_WAVELET_HAAR)
 	{
-		akoHaarInPlaceishUnliftV(hp_w, hp_h, lp, hp_c, aux, hp_c);
-		akoHaarInPlaceishUnliftV(hp_w, hp_h, hp_b, hp_d, hp_b, hp_d);
+		akoHaarInPlaceishUnliftV(hp_w, hp_h, 1, q, lp, hp_c, aux, hp_c);
+		akoHaarInPlaceishUnliftV(hp_w, hp_h, q, q, hp_b, hp_d, hp_b, hp_d);
 
 		akoHaarUnliftH(hp_w, hp_h, target_w * 2, ignore_last_col, aux, hp_b, lp + 0);
 		akoHaarUnliftH(hp_w, hp_h - ignore_last_row, target_w * 2, ignore_last_col, hp_c, hp_d, lp + target_w);
 	}
 	else if (s->wavelet == AKO_WAVELET_CDF53 || hp_w < 8 || hp_h < 8)
 	{
-		akoCdf53InPlaceishUnliftV(s->wrap, hp_w, hp_h, lp, hp_c, aux, hp_c);
-		akoCdf53InPlaceishUnliftV(s->wrap, hp_w, hp_h, hp_b, hp_d, hp_b, hp_d);
+		akoCdf53InPlaceishUnliftV(s->wrap, hp_w, hp_h, 1, q, lp, hp_c, aux, hp_c);
+		akoCdf53InPlaceishUnliftV(s->wrap, hp_w, hp_h, q, q, hp_b, hp_d, hp_b, hp_d);
 
 		akoCdf53UnliftH(s->wrap, hp_w, hp_h, target_w * 2, ignore_last_col, aux, hp_b, lp + 0);
 		akoCdf53UnliftH(s->wrap, hp_w, hp_h - ignore_last_row, target_w * 2, ignore_last_col, hp_c, hp_d,
@@ -134,8 +205,8 @@ static void s2dUnliftHp(const struct akoSettings* s, size_t ch, size_t tile_w, s
 	}
 	else
 	{
-		akoDd137InPlaceishUnliftV(s->wrap, hp_w, hp_h, lp, hp_c, aux, hp_c);
-		akoDd137InPlaceishUnliftV(s->wrap, hp_w, hp_h, hp_b, hp_d, hp_b, hp_d);
+		akoDd137InPlaceishUnliftV(s->wrap, hp_w, hp_h, 1, q, lp, hp_c, aux, hp_c);
+		akoDd137InPlaceishUnliftV(s->wrap, hp_w, hp_h, q, q, hp_b, hp_d, hp_b, hp_d);
 
 		akoDd137UnliftH(s->wrap, hp_w, hp_h, target_w * 2, ignore_last_col, aux, hp_b, lp + 0);
 		akoDd137UnliftH(s->wrap, hp_w, hp_h - ignore_last_row, target_w * 2, ignore_last_col, hp_c, hp_d,
@@ -157,10 +228,35 @@ static inline void s2dMemcpy(int16_t q, int16_t g, size_t w, size_t h, size_t in
 	if (q < 1)
 		q = 1;
 
+	// Nothing to gate nor quantize (lowpasses), just copy
+	if (q == 1 && g <= 0)
+	{
+		for (size_t r = 0; r < h; r++)
+		{
+			for (size_t c = 0; c < w; c++)
+				out[c] = in[c];
+
+			in += in_stride;
+			out += w;
+		}
+
+		return;
+	}
+
+	// Highpasses, gate and quantize
+	const struct akoKernels* k = akoKernels();
+
+	struct akoReciprocal reciprocal; // Divisions are slow, specially on a tail
+	akoReciprocal(q, &reciprocal);
+
 	for (size_t r = 0; r < h; r++)
 	{
-		for (size_t c = 0; c < w; c++)
-			out[c] = (in[c] < -g || in[c] > +g) ? (in[c] / q) : 0;
+		size_t c = 0;
+		if (k->quantize != NULL)
+			c = k->quantize(0, w, &reciprocal, g, in, out);
+
+		for (; c < w; c++)
+			out[c] = (in[c] < -g || in[c] > +g) ? sDivide(in[c], &reciprocal) : 0;
 
 		in += in_stride;
 		out += w;
@@ -168,8 +264,8 @@ static inline void s2dMemcpy(int16_t q, int16_t g, size_t w, size_t h, size_t in
 }
 
 
-void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_t tile_w, size_t tile_h,
-             size_t planes_space, int16_t* in, int16_t* output)
+void akoLift(size_t tile_no, const struct akoSettings* s, const struct akoQuantizationTable* table, size_t channels,
+             size_t tile_w, size_t tile_h, size_t planes_space, int16_t* in, int16_t* output)
 {
 	// Protip: everything here operates in reverse
 
@@ -179,7 +275,7 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 	uint8_t* out = (uint8_t*)output + akoTileDataSize(tile_w, tile_h) * channels; // Output end
 
 	// Highpasses
-	while (target_w > 2 && target_h > 2)
+	for (size_t lift = 0; target_w > 2 && target_h > 2; lift++)
 	{
 		const size_t current_w = target_w;
 		const size_t current_h = target_h;
@@ -196,19 +292,8 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 		// Iterate in Vuy order
 		for (size_t ch = (channels - 1); ch < channels; ch--) // Yes, underflows
 		{
-			int16_t q = 0;
-			int16_t g = 0;
-
-			if (ch == 0)
-			{
-				q = akoQuantization(s->quantization, 1, tile_w, tile_h, current_w, current_h);
-				g = akoGate(s->gate, 1, tile_w, tile_h, current_w, current_h);
-			}
-			else
-			{
-				q = akoQuantization(s->quantization, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
-				g = akoGate(s->gate, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
-			}
+			const int16_t q = table->q[(ch == 0) ? 0 : 1][lift];
+			const int16_t g = table->g[(ch == 0) ? 0 : 1][lift];
 
 			// 1. Lift
 			int16_t* lp = in + (tile_w * tile_h + planes_space) * ch;
@@ -277,12 +362,15 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 	if (tile_no == 0)
 		AKO_DEV_PRINTF("D\t%zux%zu\n", target_w, target_h);
 
+	// (if there were no lifts, the lowpass is the plane as formatted, with its original stride)
+	const size_t lp_stride = (target_w != tile_w) ? (target_w * 2) : tile_w;
+
 	for (size_t ch = (channels - 1); ch < channels; ch--)
 	{
 		out -= (target_w * target_h) * sizeof(int16_t); // ... And one lowpass
 
 		int16_t* lp = in + (tile_w * tile_h + planes_space) * ch;
-		s2dMemcpy(1, 0, target_w, target_h, (target_w * 2), lp, (int16_t*)out); // LP
+		s2dMemcpy(1, 0, target_w, target_h, lp_stride, lp, (int16_t*)out); // LP
 
 		// Developers, developers, developers
 		// if (tile_no == 0)
@@ -293,12 +381,23 @@ void akoLift(size_t tile_no, const struct akoSettings* s, size_t channels, size_
 
 
 void akoUnlift(const struct akoSettings* s, size_t channels, size_t tile_no, size_t tile_w, size_t tile_h,
-               size_t out_planes_space, coeff_t* input, coeff_t* out)
+               size_t out_planes_space, size_t skip_lifts, coeff_t* input, coeff_t* out)
 {
 	struct akoUnliftCallbackData data = {0};
 	data.out = out;
 	data.out_planes_space = out_planes_space;
 	data.tile_no = tile_no;
 
+	// Skipped lifts are the last ones, those that (in reverse) gave us the tile dimensions.
+	// Their highpasses may not even be decompressed, we don't touch them
+	data.stop_w = tile_w;
+	data.stop_h = tile_h;
+
+	for (size_t i = 0; i < skip_lifts && data.stop_w > 2 && data.stop_h > 2; i++)
+	{
+		data.stop_w = akoDividePlusOneRule(data.stop_w);
+		data.stop_h = akoDividePlusOneRule(data.stop_h);
+	}
+
 	akoIterateLifts(s, channels, tile_w, tile_h, input, s2dUnliftLp, s2dUnliftHp, &data);
 }
@@ -0,0 +1,415 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// rANS, from the prototype at './resources/research/ans1/', now with normalized
+// frequency tables per tile and renormalization to bytes (Duda 2014, and Giesen's
+// 'ryg_rans' for the byte-wise variant).
+
+// Coefficients get zigzag-ed and mapped to tokens. Small values are tokens by
+// themselves, bigger ones a token per magnitude and its next bit, plus the
+// remaining bits coded with uniform probability in the same stream.
+
+// Interleaved states share the stream, with coefficients going round-robin to
+// them. A decoder then advances several independent states, rather than one
+// latency-bound chain of multiplications and renormalizations.
+
+// Block layout: for each context tokens number (one byte) and their frequencies
+// (one or two bytes each), then final encoder states (four bytes each) and the
+// stream. Tables cost up to a few hundred bytes, on small blocks akoCompress()
+// keeps Kagari instead.
+
+
+#define SCALE_BITS 12
+#define SCALE (1 << SCALE_BITS) // Frequencies sum
+
+#define STATE_LOW (1U << 23) // Normalized states live in [STATE_LOW, STATE_LOW * 256)
+
+#define DIRECT_TOKENS 16                      // Zigzag-ed values under this are tokens as they are
+#define TOKENS (DIRECT_TOKENS + (16 - 4) * 2) // Then two per length, from five to sixteen bits
+#define CONTEXTS 3                            // A frequency table for each, see sContext()
+
+#define STATES 4 // Interleaved, coefficient 'i' goes to state 'i % STATES'
+
+
+static inline uint16_t sZigZagEncode(int16_t in)
+{
+	return (uint16_t)(((uint16_t)in << 1) ^ (in >> 15));
+}
+
+static inline int16_t sZigZagDecode(uint16_t in)
+{
+	return (int16_t)((in >> 1) ^ (~(in & 1) + 1));
+}
+
+
+static inline uint32_t sToken(uint16_t z, int* out_raw_bits)
+{
+	if (z < DIRECT_TOKENS)
+	{
+		*out_raw_bits = 0;
+		return z;
+	}
+
+	const int len = 32 - __builtin_clz((uint32_t)z);
+	*out_raw_bits = len - 2;
+
+	return DIRECT_TOKENS + (uint32_t)(len - 5) * 2 + ((uint32_t)(z >> (len - 2)) & 1);
+}
+
+static inline uint16_t sFromToken(uint32_t token, int* out_raw_bits)
+{
+	if (token < DIRECT_TOKENS)
+	{
+		*out_raw_bits = 0;
+		return (uint16_t)token;
+	}
+
+	const int len = (int)(token - DIRECT_TOKENS) / 2 + 5;
+	*out_raw_bits = len - 2;
+
+	return (uint16_t)((2 | ((token - DIRECT_TOKENS) & 1)) << (len - 2)); // Raw bits go Or-ed here
+}
+
+
+static inline size_t sContext(const int16_t* in, size_t i)
+{
+	// Previous value being zero, small or big. Zeros come in runs
+	// and magnitudes in neighbourhoods, this gets us most of Rle
+	if (i == 0)
+		return 0;
+
+	const uint16_t z = sZigZagEncode(in[i - 1]);
+	return (z == 0) ? 0 : ((z < 9) ? 1 : 2);
+}
+
+
+static void sNormalize(size_t no, uint32_t* frequency)
+{
+	// Scale counts to sum SCALE, those present never falling to zero. Floors plus those
+	// ones make the sum a bit off, the most frequent token absorbs the difference
+	size_t largest = 0;
+	uint32_t largest_count = 0;
+	uint32_t sum = 0;
+
+	for (size_t t = 0; t < TOKENS; t++)
+	{
+		if (frequency[t] == 0)
+			continue;
+
+		if (frequency[t] > largest_count)
+		{
+			largest = t;
+			largest_count = frequency[t];
+		}
+
+		frequency[t] = (uint32_t)(((uint64_t)frequency[t] * SCALE) / no);
+		if (frequency[t] == 0)
+			frequency[t] = 1;
+
+		sum += frequency[t];
+	}
+
+	// Being at most TOKENS off, and the largest at least SCALE / TOKENS, it never underflows
+	frequency[largest] = frequency[largest] + SCALE - sum;
+}
+
+
+static inline int sPut(uint32_t* state, uint8_t** cursor, const uint8_t* start, uint32_t cumulative,
+                       uint32_t frequency)
+{
+	// Renormalize, so the state stays in range after encoding
+	const uint32_t max = ((STATE_LOW >> SCALE_BITS) << 8) * frequency;
+	uint32_t x = *state;
+
+	for (; x >= max; x >>= 8)
+	{
+		if (*cursor == start)
+			return 0;
+
+		*cursor = *cursor - 1;
+		**cursor = (uint8_t)(x & 0xFF);
+	}
+
+	// Encode, C(s, x) = m * floor(x / l[s]) + b[s] + mod(x, l[s])
+	*state = ((x / frequency) << SCALE_BITS) + (x % frequency) + cumulative;
+	return 1;
+}
+
+static inline int sPutRaw(uint32_t* state, uint8_t** cursor, const uint8_t* start, uint32_t value, int bits)
+{
+	// As above, with a frequency of one in a scale of 'bits'
+	const uint32_t max = (STATE_LOW >> bits) << 8;
+	uint32_t x = *state;
+
+	for (; x >= max; x >>= 8)
+	{
+		if (*cursor == start)
+			return 0;
+
+		*cursor = *cursor - 1;
+		**cursor = (uint8_t)(x & 0xFF);
+	}
+
+	*state = (x << bits) + value;
+	return 1;
+}
+
+
+static inline int sRenormalize(uint32_t* state, const uint8_t** cursor, const uint8_t* end)
+{
+	for (; *state < STATE_LOW; *cursor = *cursor + 1)
+	{
+		if (*cursor == end)
+			return 0;
+
+		*state = (*state << 8) | **cursor;
+	}
+
+	return 1;
+}
+
+
+size_t akoManbavaranEncode(size_t input_size, size_t output_size, const void* input, void* output)
+{
+	const int16_t* in = input;
+	const size_t no = input_size / sizeof(int16_t);
+
+	uint8_t* out = output;
+	const uint8_t* out_end = (uint8_t*)output + output_size;
+
+	uint32_t frequency[CONTEXTS][TOKENS];
+	uint32_t cumulative[CONTEXTS][TOKENS];
+	int raw_bits;
+
+	if (output_size == 0 || input_size == 0)
+		return 0;
+	if ((input_size % 2) != 0)
+		return 0;
+
+	// Count tokens
+	for (size_t x = 0; x < CONTEXTS; x++)
+		for (size_t t = 0; t < TOKENS; t++)
+			frequency[x][t] = 0;
+
+	for (size_t i = 0; i < no; i++)
+		frequency[sContext(in, i)][sToken(sZigZagEncode(in[i]), &raw_bits)] += 1;
+
+	// Normalize, accumulate and write them
+	for (size_t x = 0; x < CONTEXTS; x++)
+	{
+		uint32_t total = 0;
+		uint32_t tokens_no = 0;
+		for (size_t t = 0; t < TOKENS; t++)
+			total += frequency[x][t];
+
+		if (total == 0) // Unused, still needs to sum SCALE
+		{
+			frequency[x][0] = 1;
+			total = 1;
+		}
+
+		sNormalize(total, frequency[x]);
+
+		for (uint32_t t = 0, c = 0; t < TOKENS; t++)
+		{
+			cumulative[x][t] = c;
+			c += frequency[x][t];
+
+			if (frequency[x][t] != 0)
+				tokens_no = t + 1;
+		}
+
+		if ((size_t)(out_end - out) < 1 + tokens_no * 2 + sizeof(uint32_t) * STATES)
+			return 0;
+
+		*out++ = (uint8_t)tokens_no;
+		for (uint32_t t = 0; t < tokens_no; t++)
+		{
+			if (frequency[x][t] > 127)
+				*out++ = (uint8_t)((frequency[x][t] >> 8) | 0x80);
+			*out++ = (uint8_t)(frequency[x][t] & 0xFF);
+		}
+	}
+
+	// Encode, in reverse so the decoder goes forward. Output also goes in reverse,
+	// from its end, leaving space for the final state at the beginning
+	uint8_t* stream_start = out + sizeof(uint32_t) * STATES;
+	uint8_t* cursor = (uint8_t*)out_end;
+	uint32_t state[STATES];
+
+	for (size_t i = 0; i < STATES; i++)
+		state[i] = STATE_LOW;
+
+	for (size_t i = (no - 1); i < no; i--) // Underflows
+	{
+		const size_t x = sContext(in, i);
+		const uint16_t z = sZigZagEncode(in[i]);
+		const uint32_t t = sToken(z, &raw_bits);
+		uint32_t* st = &state[i % STATES];
+
+		if (raw_bits != 0 && sPutRaw(st, &cursor, stream_start, z & ((1U << raw_bits) - 1), raw_bits) == 0)
+			return 0;
+		if (sPut(st, &cursor, stream_start, cumulative[x][t], frequency[x][t]) == 0)
+			return 0;
+	}
+
+	// Final states, then move the stream next to them
+	for (size_t i = 0; i < sizeof(uint32_t) * STATES; i++)
+		*out++ = (uint8_t)((state[i / sizeof(uint32_t)] >> ((i % sizeof(uint32_t)) * 8)) & 0xFF);
+
+	for (; cursor < out_end; cursor++)
+		*out++ = *cursor;
+
+	// Bye!
+	return (size_t)(out - (uint8_t*)output);
+}
+
+
+struct akoManbavaranTables
+{
+	uint16_t frequency[CONTEXTS][TOKENS];
+	uint16_t cumulative[CONTEXTS][TOKENS];
+	uint8_t token_of[CONTEXTS][SCALE]; // Slot to token
+};
+
+static inline int sGet(const struct akoManbavaranTables* tables, size_t x, uint32_t* state, const uint8_t** cursor,
+                       const uint8_t* end, int16_t* out)
+{
+	int raw_bits;
+
+	// D(x, s) = l[s] * floor(x / m) + mod(x, m) - b[s]
+	// Context comes from the previous coefficient, that another state is still
+	// decoding. Looking up on all tables and selecting later keeps the slot
+	// lookup out of that dependency chain
+	const uint32_t slot = *state & (SCALE - 1);
+	const uint32_t t0 = tables->token_of[0][slot];
+	const uint32_t t1 = tables->token_of[1][slot];
+	const uint32_t t2 = tables->token_of[2][slot];
+	const uint32_t t = (x == 0) ? t0 : (x == 1) ? t1 : t2;
+
+	*state = tables->frequency[x][t] * (*state >> SCALE_BITS) + slot - tables->cumulative[x][t];
+	if (sRenormalize(state, cursor, end) == 0)
+		return 0;
+
+	uint16_t z = sFromToken(t, &raw_bits);
+	if (raw_bits != 0)
+	{
+		z = (uint16_t)(z | (*state & ((1U << raw_bits) - 1)));
+		*state >>= raw_bits;
+
+		if (sRenormalize(state, cursor, end) == 0)
+			return 0;
+	}
+
+	*out = sZigZagDecode(z);
+	return 1;
+}
+
+
+size_t akoManbavaranDecode(size_t no, size_t input_size, size_t output_size, const void* input, void* output)
+{
+	const uint8_t* in = input;
+	const uint8_t* in_end = (const uint8_t*)input + input_size;
+
+	int16_t* out = output;
+
+	struct akoManbavaranTables tables;
+	uint32_t tokens_no = 0;
+	uint32_t state[STATES];
+
+	if (output_size == 0 || input_size == 0 || no == 0)
+		return 0;
+	if ((output_size % 2) != 0 || no > output_size / sizeof(int16_t))
+		return 0;
+
+	// Read tables
+	for (size_t x = 0; x < CONTEXTS; x++)
+	{
+		if (in >= in_end || (tokens_no = *in++) > TOKENS)
+			return 0;
+
+		uint32_t c = 0;
+		for (uint32_t t = 0; t < tokens_no; t++)
+		{
+			if (in + 2 > in_end)
+				return 0;
+
+			uint16_t f = *in++;
+			if ((f & 0x80) != 0)
+				f = (uint16_t)(((f & 0x7F) << 8) | *in++);
+
+			if (c + f > SCALE)
+				return 0;
+
+			tables.frequency[x][t] = f;
+			tables.cumulative[x][t] = (uint16_t)c;
+			for (uint32_t u = c; u < c + f; u++)
+				tables.token_of[x][u] = (uint8_t)t;
+
+			c += f;
+		}
+
+		if (c != SCALE) // Otherwise some slots point nowhere
+			return 0;
+	}
+
+	// Initial states
+	if (in + sizeof(uint32_t) * STATES > in_end)
+		return 0;
+
+	for (size_t i = 0; i < STATES; i++)
+	{
+		state[i] = 0;
+		for (size_t b = 0; b < sizeof(uint32_t); b++)
+			state[i] |= (uint32_t)(*in++) << (b * 8);
+
+		if (state[i] < STATE_LOW)
+			return 0;
+	}
+
+	// Decode, a round over all states per iteration
+	size_t i = 0;
+	for (; i + STATES <= no; i += STATES)
+	{
+		if (sGet(&tables, sContext(out, i + 0), &state[0], &in, in_end, out + i + 0) == 0 ||
+		    sGet(&tables, sContext(out, i + 1), &state[1], &in, in_end, out + i + 1) == 0 ||
+		    sGet(&tables, sContext(out, i + 2), &state[2], &in, in_end, out + i + 2) == 0 ||
+		    sGet(&tables, sContext(out, i + 3), &state[3], &in, in_end, out + i + 3) == 0)
+			return 0;
+	}
+
+	for (; i < no; i++)
+	{
+		if (sGet(&tables, sContext(out, i), &state[i % STATES], &in, in_end, out + i) == 0)
+			return 0;
+	}
+
+	// Bye!
+	return (size_t)(in - (const uint8_t*)input);
+}
@@ -43,6 +43,8 @@ AKO_EXPORT struct akoSettings akoDefaultSettings()
 	s.chroma_loss = 1;
 	s.discard_non_visible = 0;
 
+	s.tiles_index = 0;
+
 	return s;
 }
 
@@ -58,6 +60,8 @@ AKO_EXPORT struct akoCallbacks akoDefaultCallbacks()
 	c.events = NULL;
 	c.events_data = NULL;
 
+	c.threads = 1;
+
 	return c;
 }
 
@@ -88,6 +92,8 @@ AKO_EXPORT const char* akoStatusString(enum akoStatus status)
 	case AKO_NO_ENOUGH_MEMORY: return "No enough memory";
 	case AKO_INVALID_FLAGS: return "Invalid flags";
 	case AKO_BROKEN_INPUT: return "Broken input/premature end";
+	case AKO_INVALID_REGION: return "Invalid region (outside image)";
+	case AKO_INVALID_SCALE: return "Invalid scale";
 	default: break;
 	}
 
@@ -149,6 +155,46 @@ size_t akoTileDataSize(size_t tile_w, size_t tile_h)
 }
 
 
+size_t akoTileDataPrefixSize(size_t tile_w, size_t tile_h, size_t skip_lifts)
+{
+	// Same as above, minus the last 'skip_lifts' lift steps. As the
+	// finest ones come last, this is where a decoder can stop reading
+	// when it doesn't want the tile at full resolution.
+
+	size_t size = 0;
+
+	for (size_t lift = 0; tile_w > 2 && tile_h > 2; lift++)
+	{
+		tile_w = akoDividePlusOneRule(tile_w);
+		tile_h = akoDividePlusOneRule(tile_h);
+
+		if (lift >= skip_lifts)
+		{
+			size += (tile_w * tile_h) * sizeof(int16_t) * 3;
+			size += sizeof(struct akoLiftHead);
+		}
+	}
+
+	size += (tile_w * tile_h) * sizeof(int16_t);
+
+	return size;
+}
+
+
+size_t akoTileLiftsNo(size_t tile_w, size_t tile_h)
+{
+	size_t lifts = 0;
+
+	for (; tile_w > 2 && tile_h > 2; lifts++)
+	{
+		tile_w = akoDividePlusOneRule(tile_w);
+		tile_h = akoDividePlusOneRule(tile_h);
+	}
+
+	return lifts;
+}
+
+
 size_t akoTileDimension(size_t tile_pos, size_t image_d, size_t tiles_dimension)
 {
 	if (tiles_dimension == 0)
@@ -161,6 +207,22 @@ size_t akoTileDimension(size_t tile_pos, size_t image_d, size_t tiles_dimension)
 }
 
 
+void akoTilePosition(size_t tile_no, size_t image_w, size_t tiles_dimension, size_t* out_x, size_t* out_y)
+{
+	if (tiles_dimension == 0)
+	{
+		*out_x = 0;
+		*out_y = 0;
+		return;
+	}
+
+	const size_t tiles_x = (image_w / tiles_dimension) + ((image_w % tiles_dimension != 0) ? 1 : 0);
+
+	*out_x = (tile_no % tiles_x) * tiles_dimension;
+	*out_y = (tile_no / tiles_x) * tiles_dimension;
+}
+
+
 static inline size_t sMax(size_t a, size_t b)
 {
 	return (a > b) ? a : b;
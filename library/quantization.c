@@ -96,3 +96,77 @@ int16_t akoQuantization(int factor, int factor_mul, size_t tile_w, size_t tile_h
 
 	return (int16_t)q;
 }
+
+
+void akoReciprocal(int16_t d, struct akoReciprocal* out)
+{
+	// Signed magic number, as in Hacker's Delight (10-1), for
+	// 16 bits. Arithmetic here is unsigned and wraps at 16 bits
+
+	if (d <= 1) // A mul of one plus adding the dividend gives it back
+	{
+		out->mul = 1;
+		out->shift = 0;
+		out->add = 1;
+		return;
+	}
+
+	const uint32_t two15 = 0x8000;
+	const uint32_t ad = (uint32_t)d;
+	const uint32_t anc = two15 - 1 - two15 % ad;
+
+	uint32_t q1 = two15 / anc;
+	uint32_t r1 = two15 - q1 * anc;
+	uint32_t q2 = two15 / ad;
+	uint32_t r2 = two15 - q2 * ad;
+	uint32_t delta = 0;
+	int p = 15;
+
+	do
+	{
+		p++;
+		q1 = (q1 * 2) & 0xFFFF;
+		r1 = (r1 * 2) & 0xFFFF;
+		if (r1 >= anc)
+		{
+			q1 = (q1 + 1) & 0xFFFF;
+			r1 = (r1 - anc) & 0xFFFF;
+		}
+
+		q2 = (q2 * 2) & 0xFFFF;
+		r2 = (r2 * 2) & 0xFFFF;
+		if (r2 >= ad)
+		{
+			q2 = (q2 + 1) & 0xFFFF;
+			r2 = (r2 - ad) & 0xFFFF;
+		}
+
+		delta = ad - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+
+	out->mul = (int16_t)(uint16_t)(q2 + 1);
+	out->shift = (int16_t)(p - 16);
+	out->add = (out->mul < 0) ? 1 : 0; // Multiplier didn't fit as positive
+}
+
+
+void akoQuantizationTable(const struct akoSettings* s, size_t tile_w, size_t tile_h, struct akoQuantizationTable* out)
+{
+	// Same walk as akoLift(), first lift first
+	size_t current_w = tile_w;
+	size_t current_h = tile_h;
+
+	out->tile_w = tile_w;
+	out->tile_h = tile_h;
+
+	for (size_t l = 0; l < AKO_MAX_LIFTS && current_w > 2 && current_h > 2; l++)
+	{
+		out->q[0][l] = akoQuantization(s->quantization, 1, tile_w, tile_h, current_w, current_h);
+		out->g[0][l] = akoGate(s->gate, 1, tile_w, tile_h, current_w, current_h);
+		out->q[1][l] = akoQuantization(s->quantization, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
+		out->g[1][l] = akoGate(s->gate, s->chroma_loss + 1, tile_w, tile_h, current_w, current_h);
+
+		current_w = akoDividePlusOneRule(current_w);
+		current_h = akoDividePlusOneRule(current_h);
+	}
+}
@@ -0,0 +1,134 @@
+/*
+
+MIT License
+
+Copyright (c) 2021-2022 Alexander Brandt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ako-private.h"
+
+
+// Workers are spawned and joined on every call, there is no pool. Tiles are
+// big enough units of work to make the creation cost negligible, and this
+// way nothing outlives an akoEncodeExt()/akoDecodeExt() call.
+
+// Without threads support (freestanding builds) workers just run one after
+// the other, in the calling thread.
+
+
+#if (AKO_FREESTANDING == 0) && defined(_WIN32)
+#include <windows.h>
+#define THREADS_WIN32
+#elif (AKO_FREESTANDING == 0)
+#include <pthread.h>
+#define THREADS_PTHREADS
+#endif
+
+
+#define THREADS_MAX 256
+
+
+struct akoThreadsArg
+{
+	void (*worker)(size_t, void*);
+	void* data;
+	size_t worker_no;
+};
+
+
+#if defined(THREADS_WIN32)
+static DWORD WINAPI sWrapper(LPVOID raw_arg)
+{
+	const struct akoThreadsArg* arg = raw_arg;
+	arg->worker(arg->worker_no, arg->data);
+	return 0;
+}
+#elif defined(THREADS_PTHREADS)
+static void* sWrapper(void* raw_arg)
+{
+	const struct akoThreadsArg* arg = raw_arg;
+	arg->worker(arg->worker_no, arg->data);
+	return NULL;
+}
+#endif
+
+
+size_t akoThreadsNo(size_t threads, size_t jobs_no)
+{
+	if (threads > THREADS_MAX)
+		threads = THREADS_MAX;
+	if (threads > jobs_no)
+		threads = jobs_no;
+
+	return (threads != 0) ? threads : 1;
+}
+
+
+void akoThreadsRun(size_t workers_no, void (*worker)(size_t worker_no, void* data), void* data)
+{
+	struct akoThreadsArg args[THREADS_MAX];
+	int spawned[THREADS_MAX];
+
+#if defined(THREADS_WIN32)
+	HANDLE threads[THREADS_MAX];
+#elif defined(THREADS_PTHREADS)
+	pthread_t threads[THREADS_MAX];
+#endif
+
+	workers_no = akoThreadsNo(workers_no, workers_no);
+
+	// Spawn workers, the first one runs in the calling thread
+	for (size_t i = 1; i < workers_no; i++)
+	{
+		args[i].worker = worker;
+		args[i].data = data;
+		args[i].worker_no = i;
+		spawned[i] = 0;
+
+#if defined(THREADS_WIN32)
+		if ((threads[i] = CreateThread(NULL, 0, sWrapper, &args[i], 0, NULL)) != NULL)
+			spawned[i] = 1;
+#elif defined(THREADS_PTHREADS)
+		if (pthread_create(&threads[i], NULL, sWrapper, &args[i]) == 0)
+			spawned[i] = 1;
+#endif
+	}
+
+	worker(0, data);
+
+	// Join them, doing ourselves the work of those that failed to spawn
+	for (size_t i = 1; i < workers_no; i++)
+	{
+		if (spawned[i] == 0)
+		{
+			worker(i, data);
+			continue;
+		}
+
+#if defined(THREADS_WIN32)
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#elif defined(THREADS_PTHREADS)
+		pthread_join(threads[i], NULL);
+#endif
+	}
+}
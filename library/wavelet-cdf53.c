@@ -26,6 +26,10 @@ SOFTWARE.
 
 #include "ako-private.h"
 
+#if (AKO_SIMD_X86 == 1)
+#include <immintrin.h>
+#endif
+
 
 // Cdf53, Cohen–Daubechies–Feauveau 5/3:
 //   > 5/3: { d[n] = d0[n] - floor((1 / 2) * (s0[n] + s0[n + 1])) }
@@ -53,14 +57,518 @@ static inline int16_t sOdd(int16_t hp, int16_t even, int16_t even_p1)
 	return hp + (even + even_p1) / 2;
 }
 
+static inline int16_t sDequantize(int16_t v, int16_t q) // Inverse quantization, as inputs get loaded
+{
+	return (int16_t)(v * q);
+}
+
+
+// Simd versions of above, for the interior of rows. Divisions have to round
+// towards zero, as C does, and sums of two coefficients can overflow 16 bits;
+// so we take the floor from an overflow-free average (a & b) + ((a ^ b) >> 1),
+// and correct it when negative and inexact. Output is the same, bit by bit.
+
+// Each kernel starts at column 'c' and returns where it stopped, leaving
+// whatever doesn't fill a whole vector to the next one (Avx512 -> Avx2 ->
+// Sse2 -> C). Which one goes first is up to the kernels table, in cpu.c.
+
+#if (AKO_SIMD_X86 == 1)
+static inline __m128i sHalfSse2(__m128i a, __m128i b)
+{
+	const __m128i x = _mm_xor_si128(a, b);
+	const __m128i floor = _mm_add_epi16(_mm_and_si128(a, b), _mm_srai_epi16(x, 1));
+	const __m128i inexact = _mm_slli_epi16(x, 15); // Lowest bit of the sum, at sign position
+	return _mm_add_epi16(floor, _mm_srli_epi16(_mm_and_si128(floor, inexact), 15));
+}
+
+static inline __m128i sQuarterSse2(__m128i a, __m128i b)
+{
+	const __m128i x = _mm_xor_si128(a, b);
+	const __m128i sum = _mm_add_epi16(a, b); // Overflows, but two lowest bits are right
+	const __m128i floor = _mm_srai_epi16(_mm_add_epi16(_mm_and_si128(a, b), _mm_srai_epi16(x, 1)), 1);
+	const __m128i inexact = _mm_slli_epi16(_mm_or_si128(sum, _mm_srli_epi16(sum, 1)), 15);
+	return _mm_add_epi16(floor, _mm_srli_epi16(_mm_and_si128(floor, inexact), 15));
+}
+
+static inline __m128i sLoadSse2(const int16_t* p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void sStoreSse2(int16_t* p, __m128i v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline __m128i sDequantizeSse2(__m128i v, __m128i q)
+{
+	return _mm_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+static inline __m128i sEvensSse2(const int16_t* p) // Reads 16 values
+{
+	const __m128i a = _mm_srai_epi32(_mm_slli_epi32(sLoadSse2(p + 0), 16), 16);
+	const __m128i b = _mm_srai_epi32(_mm_slli_epi32(sLoadSse2(p + 8), 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static inline __m128i sOddsSse2(const int16_t* p) // Ditto
+{
+	const __m128i a = _mm_srai_epi32(sLoadSse2(p + 0), 16);
+	const __m128i b = _mm_srai_epi32(sLoadSse2(p + 8), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static size_t sHpRowSse2(size_t c, size_t end, const int16_t* odd, const int16_t* even, const int16_t* even_p1,
+                         int16_t* out)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i odd_v = sLoadSse2(odd + c);
+		const __m128i even_v = sLoadSse2(even + c);
+		const __m128i even_p1_v = sLoadSse2(even_p1 + c);
+		sStoreSse2(out + c, _mm_sub_epi16(odd_v, sHalfSse2(even_v, even_p1_v)));
+	}
+	return c;
+}
+
+static size_t sLpRowSse2(size_t c, size_t end, const int16_t* even, const int16_t* hp_l1, const int16_t* hp,
+                         int16_t* out)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i even_v = sLoadSse2(even + c);
+		const __m128i hp_l1_v = sLoadSse2(hp_l1 + c);
+		const __m128i hp_v = sLoadSse2(hp + c);
+		sStoreSse2(out + c, _mm_add_epi16(even_v, sQuarterSse2(hp_l1_v, hp_v)));
+	}
+	return c;
+}
+
+static size_t sEvenRowSse2(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp, const int16_t* hp_l1,
+                           const int16_t* hp, int16_t* out)
+{
+	const __m128i lp_q_v = _mm_set1_epi16(lp_q);
+	const __m128i hp_q_v = _mm_set1_epi16(hp_q);
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i lp_v = sDequantizeSse2(sLoadSse2(lp + c), lp_q_v);
+		const __m128i hp_l1_v = sDequantizeSse2(sLoadSse2(hp_l1 + c), hp_q_v);
+		const __m128i hp_v = sDequantizeSse2(sLoadSse2(hp + c), hp_q_v);
+		sStoreSse2(out + c, _mm_sub_epi16(lp_v, sQuarterSse2(hp_l1_v, hp_v)));
+	}
+	return c;
+}
+
+static size_t sOddRowSse2(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even,
+                          const int16_t* even_p1, int16_t* out)
+{
+	const __m128i hp_q_v = _mm_set1_epi16(hp_q);
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i hp_v = sDequantizeSse2(sLoadSse2(hp + c), hp_q_v);
+		const __m128i even_v = sLoadSse2(even + c);
+		const __m128i even_p1_v = sLoadSse2(even_p1 + c);
+		sStoreSse2(out + c, _mm_add_epi16(hp_v, sHalfSse2(even_v, even_p1_v)));
+	}
+	return c;
+}
+
+static size_t sHpInterleavedSse2(size_t c, size_t end, const int16_t* in, int16_t* out_hp)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i even = sEvensSse2(in + c * 2);
+		const __m128i odd = sOddsSse2(in + c * 2);
+		const __m128i even_p1 = sEvensSse2(in + c * 2 + 2);
+		sStoreSse2(out_hp + c, _mm_sub_epi16(odd, sHalfSse2(even, even_p1)));
+	}
+	return c;
+}
+
+static size_t sLpInterleavedSse2(size_t c, size_t end, const int16_t* in, const int16_t* hp, int16_t* out_lp)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i even = sEvensSse2(in + c * 2);
+		sStoreSse2(out_lp + c, _mm_add_epi16(even, sQuarterSse2(sLoadSse2(hp + c - 1), sLoadSse2(hp + c))));
+	}
+	return c;
+}
+
+static size_t sUnliftInterleavedSse2(size_t c, size_t end, const int16_t* lp, const int16_t* hp, int16_t* out)
+{
+	// Evens from 'c', odds from 'c - 1', both end interleaved in the output
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i hp_l2 = sLoadSse2(hp + c - 2);
+		const __m128i hp_l1 = sLoadSse2(hp + c - 1);
+		const __m128i even_l1 = _mm_sub_epi16(sLoadSse2(lp + c - 1), sQuarterSse2(hp_l2, hp_l1));
+		const __m128i even = _mm_sub_epi16(sLoadSse2(lp + c), sQuarterSse2(hp_l1, sLoadSse2(hp + c)));
+		const __m128i odd_l1 = _mm_add_epi16(hp_l1, sHalfSse2(even_l1, even));
+
+		sStoreSse2(out + c * 2 - 1, _mm_unpacklo_epi16(odd_l1, even));
+		sStoreSse2(out + c * 2 + 7, _mm_unpackhi_epi16(odd_l1, even));
+	}
+	return c;
+}
+
+
+AKO_TARGET_AVX2 static inline __m256i sHalfAvx2(__m256i a, __m256i b)
+{
+	const __m256i x = _mm256_xor_si256(a, b);
+	const __m256i floor = _mm256_add_epi16(_mm256_and_si256(a, b), _mm256_srai_epi16(x, 1));
+	const __m256i inexact = _mm256_slli_epi16(x, 15);
+	return _mm256_add_epi16(floor, _mm256_srli_epi16(_mm256_and_si256(floor, inexact), 15));
+}
+
+AKO_TARGET_AVX2 static inline __m256i sQuarterAvx2(__m256i a, __m256i b)
+{
+	const __m256i x = _mm256_xor_si256(a, b);
+	const __m256i sum = _mm256_add_epi16(a, b);
+	const __m256i floor = _mm256_srai_epi16(_mm256_add_epi16(_mm256_and_si256(a, b), _mm256_srai_epi16(x, 1)), 1);
+	const __m256i inexact = _mm256_slli_epi16(_mm256_or_si256(sum, _mm256_srli_epi16(sum, 1)), 15);
+	return _mm256_add_epi16(floor, _mm256_srli_epi16(_mm256_and_si256(floor, inexact), 15));
+}
+
+AKO_TARGET_AVX2 static inline __m256i sLoadAvx2(const int16_t* p)
+{
+	return _mm256_loadu_si256((const __m256i*)p);
+}
+
+AKO_TARGET_AVX2 static inline void sStoreAvx2(int16_t* p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i*)p, v);
+}
+
+AKO_TARGET_AVX2 static inline __m256i sDequantizeAvx2(__m256i v, __m256i q)
+{
+	return _mm256_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+AKO_TARGET_AVX2 static inline __m256i sEvensAvx2(const int16_t* p) // Reads 32 values
+{
+	const __m256i a = _mm256_srai_epi32(_mm256_slli_epi32(sLoadAvx2(p + 0), 16), 16);
+	const __m256i b = _mm256_srai_epi32(_mm256_slli_epi32(sLoadAvx2(p + 16), 16), 16);
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8); // Packs work per 128 bits lane
+}
+
+AKO_TARGET_AVX2 static inline __m256i sOddsAvx2(const int16_t* p) // Ditto
+{
+	const __m256i a = _mm256_srai_epi32(sLoadAvx2(p + 0), 16);
+	const __m256i b = _mm256_srai_epi32(sLoadAvx2(p + 16), 16);
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+}
+
+AKO_TARGET_AVX2 static size_t sHpRowAvx2(size_t c, size_t end, const int16_t* odd, const int16_t* even,
+                                         const int16_t* even_p1, int16_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i odd_v = sLoadAvx2(odd + c);
+		const __m256i even_v = sLoadAvx2(even + c);
+		const __m256i even_p1_v = sLoadAvx2(even_p1 + c);
+		sStoreAvx2(out + c, _mm256_sub_epi16(odd_v, sHalfAvx2(even_v, even_p1_v)));
+	}
+	_mm256_zeroupper();
+	return sHpRowSse2(c, end, odd, even, even_p1, out);
+}
+
+AKO_TARGET_AVX2 static size_t sLpRowAvx2(size_t c, size_t end, const int16_t* even, const int16_t* hp_l1,
+                                         const int16_t* hp, int16_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i even_v = sLoadAvx2(even + c);
+		const __m256i hp_l1_v = sLoadAvx2(hp_l1 + c);
+		const __m256i hp_v = sLoadAvx2(hp + c);
+		sStoreAvx2(out + c, _mm256_add_epi16(even_v, sQuarterAvx2(hp_l1_v, hp_v)));
+	}
+	_mm256_zeroupper();
+	return sLpRowSse2(c, end, even, hp_l1, hp, out);
+}
+
+AKO_TARGET_AVX2 static size_t sEvenRowAvx2(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp,
+                                           const int16_t* hp_l1, const int16_t* hp, int16_t* out)
+{
+	const __m256i lp_q_v = _mm256_set1_epi16(lp_q);
+	const __m256i hp_q_v = _mm256_set1_epi16(hp_q);
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i lp_v = sDequantizeAvx2(sLoadAvx2(lp + c), lp_q_v);
+		const __m256i hp_l1_v = sDequantizeAvx2(sLoadAvx2(hp_l1 + c), hp_q_v);
+		const __m256i hp_v = sDequantizeAvx2(sLoadAvx2(hp + c), hp_q_v);
+		sStoreAvx2(out + c, _mm256_sub_epi16(lp_v, sQuarterAvx2(hp_l1_v, hp_v)));
+	}
+	_mm256_zeroupper();
+	return sEvenRowSse2(c, end, lp_q, hp_q, lp, hp_l1, hp, out);
+}
+
+AKO_TARGET_AVX2 static size_t sOddRowAvx2(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even,
+                                          const int16_t* even_p1, int16_t* out)
+{
+	const __m256i hp_q_v = _mm256_set1_epi16(hp_q);
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i hp_v = sDequantizeAvx2(sLoadAvx2(hp + c), hp_q_v);
+		const __m256i even_v = sLoadAvx2(even + c);
+		const __m256i even_p1_v = sLoadAvx2(even_p1 + c);
+		sStoreAvx2(out + c, _mm256_add_epi16(hp_v, sHalfAvx2(even_v, even_p1_v)));
+	}
+	_mm256_zeroupper();
+	return sOddRowSse2(c, end, hp_q, hp, even, even_p1, out);
+}
+
+AKO_TARGET_AVX2 static size_t sHpInterleavedAvx2(size_t c, size_t end, const int16_t* in, int16_t* out_hp)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i even = sEvensAvx2(in + c * 2);
+		const __m256i odd = sOddsAvx2(in + c * 2);
+		const __m256i even_p1 = sEvensAvx2(in + c * 2 + 2);
+		sStoreAvx2(out_hp + c, _mm256_sub_epi16(odd, sHalfAvx2(even, even_p1)));
+	}
+	_mm256_zeroupper();
+	return sHpInterleavedSse2(c, end, in, out_hp);
+}
+
+AKO_TARGET_AVX2 static size_t sLpInterleavedAvx2(size_t c, size_t end, const int16_t* in, const int16_t* hp,
+                                                 int16_t* out_lp)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i even = sEvensAvx2(in + c * 2);
+		sStoreAvx2(out_lp + c, _mm256_add_epi16(even, sQuarterAvx2(sLoadAvx2(hp + c - 1), sLoadAvx2(hp + c))));
+	}
+	_mm256_zeroupper();
+	return sLpInterleavedSse2(c, end, in, hp, out_lp);
+}
+
+AKO_TARGET_AVX2 static size_t sUnliftInterleavedAvx2(size_t c, size_t end, const int16_t* lp, const int16_t* hp,
+                                                     int16_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i hp_l2 = sLoadAvx2(hp + c - 2);
+		const __m256i hp_l1 = sLoadAvx2(hp + c - 1);
+		const __m256i even_l1 = _mm256_sub_epi16(sLoadAvx2(lp + c - 1), sQuarterAvx2(hp_l2, hp_l1));
+		const __m256i even = _mm256_sub_epi16(sLoadAvx2(lp + c), sQuarterAvx2(hp_l1, sLoadAvx2(hp + c)));
+		const __m256i odd_l1 = _mm256_add_epi16(hp_l1, sHalfAvx2(even_l1, even));
+
+		// Unpacks also work per 128 bits lane
+		const __m256i lo = _mm256_unpacklo_epi16(odd_l1, even);
+		const __m256i hi = _mm256_unpackhi_epi16(odd_l1, even);
+		sStoreAvx2(out + c * 2 - 1, _mm256_permute2x128_si256(lo, hi, 0x20));
+		sStoreAvx2(out + c * 2 + 15, _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	_mm256_zeroupper();
+	return sUnliftInterleavedSse2(c, end, lp, hp, out);
+}
+
+
+AKO_TARGET_AVX512 static inline __m512i sHalfAvx512(__m512i a, __m512i b)
+{
+	const __m512i x = _mm512_xor_si512(a, b);
+	const __m512i floor = _mm512_add_epi16(_mm512_and_si512(a, b), _mm512_srai_epi16(x, 1));
+	const __m512i inexact = _mm512_slli_epi16(x, 15);
+	return _mm512_add_epi16(floor, _mm512_srli_epi16(_mm512_and_si512(floor, inexact), 15));
+}
+
+AKO_TARGET_AVX512 static inline __m512i sQuarterAvx512(__m512i a, __m512i b)
+{
+	const __m512i x = _mm512_xor_si512(a, b);
+	const __m512i sum = _mm512_add_epi16(a, b);
+	const __m512i floor = _mm512_srai_epi16(_mm512_add_epi16(_mm512_and_si512(a, b), _mm512_srai_epi16(x, 1)), 1);
+	const __m512i inexact = _mm512_slli_epi16(_mm512_or_si512(sum, _mm512_srli_epi16(sum, 1)), 15);
+	return _mm512_add_epi16(floor, _mm512_srli_epi16(_mm512_and_si512(floor, inexact), 15));
+}
+
+AKO_TARGET_AVX512 static inline __m512i sLoadAvx512(const int16_t* p)
+{
+	return _mm512_loadu_si512((const void*)p);
+}
+
+AKO_TARGET_AVX512 static inline void sStoreAvx512(int16_t* p, __m512i v)
+{
+	_mm512_storeu_si512((void*)p, v);
+}
+
+AKO_TARGET_AVX512 static inline __m512i sDequantizeAvx512(__m512i v, __m512i q)
+{
+	return _mm512_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+AKO_TARGET_AVX512 static size_t sHpRowAvx512(size_t c, size_t end, const int16_t* odd, const int16_t* even,
+                                             const int16_t* even_p1, int16_t* out)
+{
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i odd_v = sLoadAvx512(odd + c);
+		const __m512i even_v = sLoadAvx512(even + c);
+		const __m512i even_p1_v = sLoadAvx512(even_p1 + c);
+		sStoreAvx512(out + c, _mm512_sub_epi16(odd_v, sHalfAvx512(even_v, even_p1_v)));
+	}
+	return sHpRowAvx2(c, end, odd, even, even_p1, out);
+}
+
+AKO_TARGET_AVX512 static size_t sLpRowAvx512(size_t c, size_t end, const int16_t* even, const int16_t* hp_l1,
+                                             const int16_t* hp, int16_t* out)
+{
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i even_v = sLoadAvx512(even + c);
+		const __m512i hp_l1_v = sLoadAvx512(hp_l1 + c);
+		const __m512i hp_v = sLoadAvx512(hp + c);
+		sStoreAvx512(out + c, _mm512_add_epi16(even_v, sQuarterAvx512(hp_l1_v, hp_v)));
+	}
+	return sLpRowAvx2(c, end, even, hp_l1, hp, out);
+}
+
+AKO_TARGET_AVX512 static size_t sEvenRowAvx512(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp,
+                                               const int16_t* hp_l1, const int16_t* hp, int16_t* out)
+{
+	const __m512i lp_q_v = _mm512_set1_epi16(lp_q);
+	const __m512i hp_q_v = _mm512_set1_epi16(hp_q);
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i lp_v = sDequantizeAvx512(sLoadAvx512(lp + c), lp_q_v);
+		const __m512i hp_l1_v = sDequantizeAvx512(sLoadAvx512(hp_l1 + c), hp_q_v);
+		const __m512i hp_v = sDequantizeAvx512(sLoadAvx512(hp + c), hp_q_v);
+		sStoreAvx512(out + c, _mm512_sub_epi16(lp_v, sQuarterAvx512(hp_l1_v, hp_v)));
+	}
+	return sEvenRowAvx2(c, end, lp_q, hp_q, lp, hp_l1, hp, out);
+}
+
+AKO_TARGET_AVX512 static size_t sOddRowAvx512(size_t c, size_t end, int16_t hp_q, const int16_t* hp,
+                                              const int16_t* even, const int16_t* even_p1, int16_t* out)
+{
+	const __m512i hp_q_v = _mm512_set1_epi16(hp_q);
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i hp_v = sDequantizeAvx512(sLoadAvx512(hp + c), hp_q_v);
+		const __m512i even_v = sLoadAvx512(even + c);
+		const __m512i even_p1_v = sLoadAvx512(even_p1 + c);
+		sStoreAvx512(out + c, _mm512_add_epi16(hp_v, sHalfAvx512(even_v, even_p1_v)));
+	}
+	return sOddRowAvx2(c, end, hp_q, hp, even, even_p1, out);
+}
+#endif
+
+
+static inline size_t sHpRow(const struct akoKernels* k, size_t c, size_t end, const int16_t* odd, const int16_t* even,
+                            const int16_t* even_p1, int16_t* out)
+{
+	if (k->cdf53_hp_row != NULL)
+		c = k->cdf53_hp_row(c, end, odd, even, even_p1, out);
+	return c;
+}
+
+static inline size_t sLpRow(const struct akoKernels* k, size_t c, size_t end, const int16_t* even, const int16_t* hp_l1,
+                            const int16_t* hp, int16_t* out)
+{
+	if (k->cdf53_lp_row != NULL)
+		c = k->cdf53_lp_row(c, end, even, hp_l1, hp, out);
+	return c;
+}
+
+static inline size_t sEvenRow(const struct akoKernels* k, size_t c, size_t end, int16_t lp_q, int16_t hp_q,
+                              const int16_t* lp, const int16_t* hp_l1, const int16_t* hp, int16_t* out)
+{
+	if (k->cdf53_even_row != NULL)
+		c = k->cdf53_even_row(c, end, lp_q, hp_q, lp, hp_l1, hp, out);
+	return c;
+}
+
+static inline size_t sOddRow(const struct akoKernels* k, size_t c, size_t end, int16_t hp_q, const int16_t* hp,
+                             const int16_t* even, const int16_t* even_p1, int16_t* out)
+{
+	if (k->cdf53_odd_row != NULL)
+		c = k->cdf53_odd_row(c, end, hp_q, hp, even, even_p1, out);
+	return c;
+}
+
+static inline size_t sHpInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* in,
+                                    int16_t* out_hp)
+{
+	if (k->cdf53_hp_interleaved != NULL)
+		c = k->cdf53_hp_interleaved(c, end, in, out_hp);
+	return c;
+}
+
+static inline size_t sLpInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* in,
+                                    const int16_t* hp, int16_t* out_lp)
+{
+	if (k->cdf53_lp_interleaved != NULL)
+		c = k->cdf53_lp_interleaved(c, end, in, hp, out_lp);
+	return c;
+}
+
+static inline size_t sUnliftInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* lp,
+                                        const int16_t* hp, int16_t* out)
+{
+	if (k->cdf53_unlift_interleaved != NULL)
+		c = k->cdf53_unlift_interleaved(c, end, lp, hp, out);
+	return c;
+}
+
+
+void akoCdf53Kernels(enum akoSimd simd, struct akoKernels* k)
+{
+	k->cdf53_hp_row = NULL;
+	k->cdf53_lp_row = NULL;
+	k->cdf53_even_row = NULL;
+	k->cdf53_odd_row = NULL;
+	k->cdf53_hp_interleaved = NULL;
+	k->cdf53_lp_interleaved = NULL;
+	k->cdf53_unlift_interleaved = NULL;
+
+#if (AKO_SIMD_X86 == 1)
+	if (simd >= AKO_SIMD_SSE2) // Sse4.1 doesn't add anything here
+	{
+		k->cdf53_hp_row = sHpRowSse2;
+		k->cdf53_lp_row = sLpRowSse2;
+		k->cdf53_even_row = sEvenRowSse2;
+		k->cdf53_odd_row = sOddRowSse2;
+		k->cdf53_hp_interleaved = sHpInterleavedSse2;
+		k->cdf53_lp_interleaved = sLpInterleavedSse2;
+		k->cdf53_unlift_interleaved = sUnliftInterleavedSse2;
+	}
+
+	if (simd >= AKO_SIMD_AVX2)
+	{
+		k->cdf53_hp_row = sHpRowAvx2;
+		k->cdf53_lp_row = sLpRowAvx2;
+		k->cdf53_even_row = sEvenRowAvx2;
+		k->cdf53_odd_row = sOddRowAvx2;
+		k->cdf53_hp_interleaved = sHpInterleavedAvx2;
+		k->cdf53_lp_interleaved = sLpInterleavedAvx2;
+		k->cdf53_unlift_interleaved = sUnliftInterleavedAvx2;
+	}
+
+	if (simd >= AKO_SIMD_AVX512) // Only vertical passes, horizontal ones stay as Avx2
+	{
+		k->cdf53_hp_row = sHpRowAvx512;
+		k->cdf53_lp_row = sLpRowAvx512;
+		k->cdf53_even_row = sEvenRowAvx512;
+		k->cdf53_odd_row = sOddRowAvx512;
+	}
+#else
+	(void)simd;
+#endif
+}
+
 
 void akoCdf53LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t fake_last, size_t in_stride,
                    const int16_t* in, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	for (size_t r = 0; r < current_h; r++)
 	{
-		// HP, except last
-		for (size_t c = 0; c < (target_w - 1); c++)
+		// HP, except last (vectors stop one before, as 'fake_last' means one value less to read)
+		for (size_t c = sHpInterleaved(k, 0, (target_w > 2) ? (target_w - 2) : 0, in + (r * in_stride),
+		                               out + (r * target_w * 2) + target_w);
+		     c < (target_w - 1); c++)
 		{
 			const int16_t even = in[(r * in_stride) + (c * 2 + 0)];
 			const int16_t odd = in[(r * in_stride) + (c * 2 + 1)];
@@ -111,7 +619,9 @@ void akoCdf53LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t
 		}
 
 		// LP, remaining values
-		for (size_t c = 1; c < target_w; c++)
+		for (size_t c = sLpInterleaved(k, 1, target_w - 1, in + (r * in_stride), out + (r * target_w * 2) + target_w,
+		                               out + (r * target_w * 2));
+		     c < target_w; c++)
 		{
 			const int16_t even = in[(r * in_stride) + (c * 2 + 0)];
 			const int16_t hp_l1 = out[(r * target_w * 2) + (c + target_w - 1)];
@@ -125,10 +635,14 @@ void akoCdf53LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t
 
 void akoCdf53LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const int16_t* in, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	// HP, except last
 	for (size_t r = 0; r < (target_h - 1); r++)
 	{
-		for (size_t c = 0; c < target_w; c++)
+		for (size_t c = sHpRow(k, 0, target_w, in + (r * 2 + 1) * target_w, in + (r * 2 + 0) * target_w,
+		                       in + (r * 2 + 2) * target_w, out + target_w * (target_h + r));
+		     c < target_w; c++)
 		{
 			const int16_t even = in[(r * 2 + 0) * target_w + c];
 			const int16_t odd = in[(r * 2 + 1) * target_w + c];
@@ -183,7 +697,9 @@ void akoCdf53LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const in
 	// LP, remaining values
 	for (size_t r = 1; r < target_h; r++)
 	{
-		for (size_t c = 0; c < target_w; c++)
+		for (size_t c = sLpRow(k, 0, target_w, in + (r * 2 + 0) * target_w, out + target_w * (target_h + r - 1),
+		                       out + target_w * (target_h + r + 0), out + (target_w * r));
+		     c < target_w; c++)
 		{
 			const int16_t even = in[(r * 2 + 0) * target_w + c];
 			const int16_t hp_l1 = out[target_w * (target_h + r - 1) + c];
@@ -200,6 +716,8 @@ void akoCdf53LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const in
 void akoCdf53UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size_t out_stride, size_t ignore_last,
                      const int16_t* in_lp, const int16_t* in_hp, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	for (size_t r = 0; r < current_h; r++)
 	{
 		// Even, first values
@@ -234,7 +752,10 @@ void akoCdf53UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 		}
 
 		// Middle values
-		for (size_t c = (ODD_DELAY + 1); c < (current_w - 1); c++)
+		const size_t middle = sUnliftInterleaved(k, (ODD_DELAY + 1), (current_w - 1), in_lp + (r * current_w),
+		                                         in_hp + (r * current_w), out + (r * out_stride));
+
+		for (size_t c = middle; c < (current_w - 1); c++)
 		{
 			const int16_t lp = in_lp[(r * current_w) + (c + 0)];
 			const int16_t hp_l1 = in_hp[(r * current_w) + (c - 1)];
@@ -243,7 +764,7 @@ void akoCdf53UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 			out[(r * out_stride) + (c * 2 + 0)] = sEven(lp, hp_l1, hp);
 		}
 
-		for (size_t c = (ODD_DELAY + 1); c < (current_w - 1); c++)
+		for (size_t c = middle; c < (current_w - 1); c++)
 		{
 			const int16_t hp = in_hp[(r * current_w) + (c + 0) - ODD_DELAY];
 			const int16_t even = out[(r * out_stride) + (c * 2 + 0) - ODD_DELAY * 2];
@@ -289,23 +810,25 @@ void akoCdf53UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 }
 
 
-void akoCdf53InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t current_h, const int16_t* in_lp,
-                               const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp)
+void akoCdf53InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q,
+                               const int16_t* in_lp, const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp)
 {
+	const struct akoKernels* k = akoKernels();
+
 	// Even, first value
 	{
 		const size_t r = 0;
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(r + 0) * current_w + c];
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t lp = sDequantize(in_lp[(r + 0) * current_w + c], lp_q);
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 
 			int16_t hp_l1;
 			switch (wrap)
 			{
 			case AKO_WRAP_CLAMP: // falltrough
 			case AKO_WRAP_MIRROR: hp_l1 = hp; break;
-			case AKO_WRAP_REPEAT: hp_l1 = in_hp[(current_h - 1) * current_w + c]; break;
+			case AKO_WRAP_REPEAT: hp_l1 = sDequantize(in_hp[(current_h - 1) * current_w + c], hp_q); break;
 			case AKO_WRAP_ZERO: hp_l1 = 0; break;
 			}
 
@@ -316,11 +839,13 @@ void akoCdf53InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	// Even, remaining values
 	for (size_t r = 1; r < current_h; r++)
 	{
-		for (size_t c = 0; c < current_w; c++)
+		for (size_t c = sEvenRow(k, 0, current_w, lp_q, hp_q, in_lp + (r + 0) * current_w, in_hp + (r - 1) * current_w,
+		                         in_hp + (r + 0) * current_w, out_lp + (r * current_w));
+		     c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(r + 0) * current_w + c];
-			const int16_t hp_l1 = in_hp[(r - 1) * current_w + c];
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t lp = sDequantize(in_lp[(r + 0) * current_w + c], lp_q);
+			const int16_t hp_l1 = sDequantize(in_hp[(r - 1) * current_w + c], hp_q);
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 
 			out_lp[(r * current_w) + c] = sEven(lp, hp_l1, hp);
 		}
@@ -329,9 +854,11 @@ void akoCdf53InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	// Odd, except last
 	for (size_t r = 0; r < (current_h - 1); r++)
 	{
-		for (size_t c = 0; c < current_w; c++)
+		for (size_t c = sOddRow(k, 0, current_w, hp_q, in_hp + (r + 0) * current_w, out_lp + (r + 0) * current_w,
+		                        out_lp + (r + 1) * current_w, out_hp + (r * current_w));
+		     c < current_w; c++)
 		{
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 			const int16_t even = out_lp[(r + 0) * current_w + c];
 			const int16_t even_p1 = out_lp[(r + 1) * current_w + c];
 
@@ -344,7 +871,7 @@ void akoCdf53InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 		const size_t r = current_h - 1;
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 			const int16_t even = out_lp[(r + 0) * current_w + c];
 
 			int16_t even_p1;
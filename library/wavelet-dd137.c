@@ -26,6 +26,10 @@ SOFTWARE.
 
 #include "ako-private.h"
 
+#if (AKO_SIMD_X86 == 1)
+#include <immintrin.h>
+#endif
+
 
 // Dd137, Deslauriers-Dubuc 13/7:
 //   > 13/7-T: { d[n] = d0[n] + floor((1 / 16) * ((s0[n - 1] + s0[n + 2]) - 9 * (s0[n] + s0[n + 1])) + 0.5) }
@@ -53,10 +57,581 @@ static inline int16_t sOdd(int16_t hp, int16_t even_l1, int16_t even, int16_t ev
 	return hp - ((even_l1 + even_p2 - 9 * (even + even_p1)) / 16);
 }
 
+static inline int16_t sDequantize(int16_t v, int16_t q) // Inverse quantization, as inputs get loaded
+{
+	return (int16_t)(v * q);
+}
+
+
+// Simd versions of above, for the interior of rows. Five taps times nine don't
+// fit in 16 bits, so we interleave coefficients in pairs and let a multiply-add
+// do the sums in 32 bits, then divide rounding towards zero, as C does. Packing
+// back keeps the lowest 16 bits (as the scalar cast does), not a saturated value.
+
+// Same as in Cdf53, each kernel starts at column 'c' and returns where it stopped,
+// leaving whatever doesn't fill a whole vector to the next one (Avx512 -> Avx2 ->
+// Sse2 -> C). Which one goes first is up to the kernels table, in cpu.c.
+
+#if (AKO_SIMD_X86 == 1)
+static inline __m128i sLoadSse2(const int16_t* p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void sStoreSse2(int16_t* p, __m128i v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline __m128i sDequantizeSse2(__m128i v, __m128i q)
+{
+	return _mm_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+static inline __m128i sEvensSse2(const int16_t* p) // Reads 16 values
+{
+	const __m128i a = _mm_srai_epi32(_mm_slli_epi32(sLoadSse2(p + 0), 16), 16);
+	const __m128i b = _mm_srai_epi32(_mm_slli_epi32(sLoadSse2(p + 8), 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static inline __m128i sOddsSse2(const int16_t* p) // Ditto
+{
+	const __m128i a = _mm_srai_epi32(sLoadSse2(p + 0), 16);
+	const __m128i b = _mm_srai_epi32(sLoadSse2(p + 8), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static inline __m128i sDivideSse2(__m128i x, int shift)
+{
+	const __m128i bias = _mm_srli_epi32(_mm_srai_epi32(x, 31), 32 - shift); // (1 << shift) - 1 if negative
+	return _mm_srai_epi32(_mm_add_epi32(x, bias), shift);
+}
+
+static inline __m128i sTapsSse2(__m128i a, __m128i b, __m128i c, __m128i d, __m128i weights, int shift)
+{
+	// (a * w0 + b * w1 + c * w1 + d * w0) / (1 << shift)
+	const __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights),
+	                                 _mm_madd_epi16(_mm_unpacklo_epi16(d, c), weights));
+	const __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights),
+	                                 _mm_madd_epi16(_mm_unpackhi_epi16(d, c), weights));
+
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(sDivideSse2(lo, shift), 16), 16),
+	                       _mm_srai_epi32(_mm_slli_epi32(sDivideSse2(hi, shift), 16), 16));
+}
+
+static inline __m128i sPredictSse2(__m128i even_l1, __m128i even, __m128i even_p1, __m128i even_p2)
+{
+	return sTapsSse2(even_l1, even, even_p1, even_p2, _mm_set_epi16(-9, 1, -9, 1, -9, 1, -9, 1), 4);
+}
+
+static inline __m128i sUpdateSse2(__m128i hp_l2, __m128i hp_l1, __m128i hp, __m128i hp_p1)
+{
+	return sTapsSse2(hp_l2, hp_l1, hp, hp_p1, _mm_set_epi16(9, -1, 9, -1, 9, -1, 9, -1), 5);
+}
+
+static size_t sHpRowSse2(size_t c, size_t end, const int16_t* odd, const int16_t* even_l1, const int16_t* even,
+                         const int16_t* even_p1, const int16_t* even_p2, int16_t* out)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i p = sPredictSse2(sLoadSse2(even_l1 + c), sLoadSse2(even + c), sLoadSse2(even_p1 + c),
+		                               sLoadSse2(even_p2 + c));
+		sStoreSse2(out + c, _mm_add_epi16(sLoadSse2(odd + c), p));
+	}
+	return c;
+}
+
+static size_t sLpRowSse2(size_t c, size_t end, const int16_t* even, const int16_t* hp_l2, const int16_t* hp_l1,
+                         const int16_t* hp, const int16_t* hp_p1, int16_t* out)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i u =
+		    sUpdateSse2(sLoadSse2(hp_l2 + c), sLoadSse2(hp_l1 + c), sLoadSse2(hp + c), sLoadSse2(hp_p1 + c));
+		sStoreSse2(out + c, _mm_add_epi16(sLoadSse2(even + c), u));
+	}
+	return c;
+}
+
+static size_t sEvenRowSse2(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp, const int16_t* hp_l2,
+                           const int16_t* hp_l1, const int16_t* hp, const int16_t* hp_p1, int16_t* out)
+{
+	const __m128i lp_q_v = _mm_set1_epi16(lp_q);
+	const __m128i hp_q_v = _mm_set1_epi16(hp_q);
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i hp_l2_v = sDequantizeSse2(sLoadSse2(hp_l2 + c), hp_q_v);
+		const __m128i hp_l1_v = sDequantizeSse2(sLoadSse2(hp_l1 + c), hp_q_v);
+		const __m128i hp_v = sDequantizeSse2(sLoadSse2(hp + c), hp_q_v);
+		const __m128i hp_p1_v = sDequantizeSse2(sLoadSse2(hp_p1 + c), hp_q_v);
+		const __m128i u = sUpdateSse2(hp_l2_v, hp_l1_v, hp_v, hp_p1_v);
+		sStoreSse2(out + c, _mm_sub_epi16(sDequantizeSse2(sLoadSse2(lp + c), lp_q_v), u));
+	}
+	return c;
+}
+
+static size_t sOddRowSse2(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even_l1,
+                          const int16_t* even, const int16_t* even_p1, const int16_t* even_p2, int16_t* out)
+{
+	const __m128i hp_q_v = _mm_set1_epi16(hp_q);
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i p = sPredictSse2(sLoadSse2(even_l1 + c), sLoadSse2(even + c), sLoadSse2(even_p1 + c),
+		                               sLoadSse2(even_p2 + c));
+		sStoreSse2(out + c, _mm_sub_epi16(sDequantizeSse2(sLoadSse2(hp + c), hp_q_v), p));
+	}
+	return c;
+}
+
+static size_t sHpInterleavedSse2(size_t c, size_t end, const int16_t* in, int16_t* out_hp)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i p = sPredictSse2(sEvensSse2(in + c * 2 - 2), sEvensSse2(in + c * 2),
+		                               sEvensSse2(in + c * 2 + 2), sEvensSse2(in + c * 2 + 4));
+		sStoreSse2(out_hp + c, _mm_add_epi16(sOddsSse2(in + c * 2), p));
+	}
+	return c;
+}
+
+static size_t sLpInterleavedSse2(size_t c, size_t end, const int16_t* in, const int16_t* hp, int16_t* out_lp)
+{
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i u =
+		    sUpdateSse2(sLoadSse2(hp + c - 2), sLoadSse2(hp + c - 1), sLoadSse2(hp + c), sLoadSse2(hp + c + 1));
+		sStoreSse2(out_lp + c, _mm_add_epi16(sEvensSse2(in + c * 2), u));
+	}
+	return c;
+}
+
+static size_t sUnliftInterleavedSse2(size_t c, size_t end, const int16_t* lp, const int16_t* hp, int16_t* out)
+{
+	// Evens from 'c', odds from 'c - 2' as they need two evens ahead. Both end
+	// interleaved in the output, except the last two evens, written at return.
+	// Evens behind 'c' come from previous iteration (initially from the output)
+	__m128i prev = _mm_set_epi16(out[c * 2 - 2], out[c * 2 - 4], out[c * 2 - 6], 0, 0, 0, 0, 0);
+	__m128i even = prev;
+
+	for (; c + 8 <= end; c += 8)
+	{
+		const __m128i u =
+		    sUpdateSse2(sLoadSse2(hp + c - 2), sLoadSse2(hp + c - 1), sLoadSse2(hp + c), sLoadSse2(hp + c + 1));
+		even = _mm_sub_epi16(sLoadSse2(lp + c), u);
+
+		const __m128i even_l1 = _mm_or_si128(_mm_slli_si128(even, 2), _mm_srli_si128(prev, 14));
+		const __m128i even_l2 = _mm_or_si128(_mm_slli_si128(even, 4), _mm_srli_si128(prev, 12));
+		const __m128i even_l3 = _mm_or_si128(_mm_slli_si128(even, 6), _mm_srli_si128(prev, 10));
+		const __m128i odd_l2 = _mm_sub_epi16(sLoadSse2(hp + c - 2), sPredictSse2(even_l3, even_l2, even_l1, even));
+
+		sStoreSse2(out + c * 2 - 4, _mm_unpacklo_epi16(even_l2, odd_l2));
+		sStoreSse2(out + c * 2 + 4, _mm_unpackhi_epi16(even_l2, odd_l2));
+		prev = even;
+	}
+
+	out[c * 2 - 4] = (int16_t)_mm_extract_epi16(even, 6);
+	out[c * 2 - 2] = (int16_t)_mm_extract_epi16(even, 7);
+	return c;
+}
+
+
+AKO_TARGET_AVX2 static inline __m256i sLoadAvx2(const int16_t* p)
+{
+	return _mm256_loadu_si256((const __m256i*)p);
+}
+
+AKO_TARGET_AVX2 static inline void sStoreAvx2(int16_t* p, __m256i v)
+{
+	_mm256_storeu_si256((__m256i*)p, v);
+}
+
+AKO_TARGET_AVX2 static inline __m256i sDequantizeAvx2(__m256i v, __m256i q)
+{
+	return _mm256_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+AKO_TARGET_AVX2 static inline __m256i sEvensAvx2(const int16_t* p) // Reads 32 values
+{
+	const __m256i a = _mm256_srai_epi32(_mm256_slli_epi32(sLoadAvx2(p + 0), 16), 16);
+	const __m256i b = _mm256_srai_epi32(_mm256_slli_epi32(sLoadAvx2(p + 16), 16), 16);
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8); // Packs work per 128 bits lane
+}
+
+AKO_TARGET_AVX2 static inline __m256i sOddsAvx2(const int16_t* p) // Ditto
+{
+	const __m256i a = _mm256_srai_epi32(sLoadAvx2(p + 0), 16);
+	const __m256i b = _mm256_srai_epi32(sLoadAvx2(p + 16), 16);
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+}
+
+AKO_TARGET_AVX2 static inline __m256i sDivideAvx2(__m256i x, int shift)
+{
+	const __m256i bias = _mm256_srli_epi32(_mm256_srai_epi32(x, 31), 32 - shift);
+	return _mm256_srai_epi32(_mm256_add_epi32(x, bias), shift);
+}
+
+AKO_TARGET_AVX2 static inline __m256i sTapsAvx2(__m256i a, __m256i b, __m256i c, __m256i d, __m256i weights,
+                                                int shift)
+{
+	// Unpacks and packs both work per 128 bits lane, undoing each other
+	const __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights),
+	                                    _mm256_madd_epi16(_mm256_unpacklo_epi16(d, c), weights));
+	const __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights),
+	                                    _mm256_madd_epi16(_mm256_unpackhi_epi16(d, c), weights));
+
+	return _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(sDivideAvx2(lo, shift), 16), 16),
+	                          _mm256_srai_epi32(_mm256_slli_epi32(sDivideAvx2(hi, shift), 16), 16));
+}
+
+AKO_TARGET_AVX2 static inline __m256i sPredictAvx2(__m256i even_l1, __m256i even, __m256i even_p1,
+                                                   __m256i even_p2)
+{
+	return sTapsAvx2(even_l1, even, even_p1, even_p2, _mm256_set1_epi32((int32_t)0xFFF70001), 4); // (1, -9)
+}
+
+AKO_TARGET_AVX2 static inline __m256i sUpdateAvx2(__m256i hp_l2, __m256i hp_l1, __m256i hp, __m256i hp_p1)
+{
+	return sTapsAvx2(hp_l2, hp_l1, hp, hp_p1, _mm256_set1_epi32((int32_t)0x0009FFFF), 5); // (-1, 9)
+}
+
+AKO_TARGET_AVX2 static size_t sHpRowAvx2(size_t c, size_t end, const int16_t* odd, const int16_t* even_l1,
+                                         const int16_t* even, const int16_t* even_p1, const int16_t* even_p2,
+                                         int16_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i p = sPredictAvx2(sLoadAvx2(even_l1 + c), sLoadAvx2(even + c), sLoadAvx2(even_p1 + c),
+		                               sLoadAvx2(even_p2 + c));
+		sStoreAvx2(out + c, _mm256_add_epi16(sLoadAvx2(odd + c), p));
+	}
+	_mm256_zeroupper();
+	return sHpRowSse2(c, end, odd, even_l1, even, even_p1, even_p2, out);
+}
+
+AKO_TARGET_AVX2 static size_t sLpRowAvx2(size_t c, size_t end, const int16_t* even, const int16_t* hp_l2,
+                                         const int16_t* hp_l1, const int16_t* hp, const int16_t* hp_p1,
+                                         int16_t* out)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i u =
+		    sUpdateAvx2(sLoadAvx2(hp_l2 + c), sLoadAvx2(hp_l1 + c), sLoadAvx2(hp + c), sLoadAvx2(hp_p1 + c));
+		sStoreAvx2(out + c, _mm256_add_epi16(sLoadAvx2(even + c), u));
+	}
+	_mm256_zeroupper();
+	return sLpRowSse2(c, end, even, hp_l2, hp_l1, hp, hp_p1, out);
+}
+
+AKO_TARGET_AVX2 static size_t sEvenRowAvx2(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp,
+                                           const int16_t* hp_l2, const int16_t* hp_l1, const int16_t* hp,
+                                           const int16_t* hp_p1, int16_t* out)
+{
+	const __m256i lp_q_v = _mm256_set1_epi16(lp_q);
+	const __m256i hp_q_v = _mm256_set1_epi16(hp_q);
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i hp_l2_v = sDequantizeAvx2(sLoadAvx2(hp_l2 + c), hp_q_v);
+		const __m256i hp_l1_v = sDequantizeAvx2(sLoadAvx2(hp_l1 + c), hp_q_v);
+		const __m256i hp_v = sDequantizeAvx2(sLoadAvx2(hp + c), hp_q_v);
+		const __m256i hp_p1_v = sDequantizeAvx2(sLoadAvx2(hp_p1 + c), hp_q_v);
+		const __m256i u = sUpdateAvx2(hp_l2_v, hp_l1_v, hp_v, hp_p1_v);
+		sStoreAvx2(out + c, _mm256_sub_epi16(sDequantizeAvx2(sLoadAvx2(lp + c), lp_q_v), u));
+	}
+	_mm256_zeroupper();
+	return sEvenRowSse2(c, end, lp_q, hp_q, lp, hp_l2, hp_l1, hp, hp_p1, out);
+}
+
+AKO_TARGET_AVX2 static size_t sOddRowAvx2(size_t c, size_t end, int16_t hp_q, const int16_t* hp, const int16_t* even_l1,
+                                          const int16_t* even, const int16_t* even_p1, const int16_t* even_p2,
+                                          int16_t* out)
+{
+	const __m256i hp_q_v = _mm256_set1_epi16(hp_q);
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i p = sPredictAvx2(sLoadAvx2(even_l1 + c), sLoadAvx2(even + c), sLoadAvx2(even_p1 + c),
+		                               sLoadAvx2(even_p2 + c));
+		sStoreAvx2(out + c, _mm256_sub_epi16(sDequantizeAvx2(sLoadAvx2(hp + c), hp_q_v), p));
+	}
+	_mm256_zeroupper();
+	return sOddRowSse2(c, end, hp_q, hp, even_l1, even, even_p1, even_p2, out);
+}
+
+AKO_TARGET_AVX2 static size_t sHpInterleavedAvx2(size_t c, size_t end, const int16_t* in, int16_t* out_hp)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i p = sPredictAvx2(sEvensAvx2(in + c * 2 - 2), sEvensAvx2(in + c * 2),
+		                               sEvensAvx2(in + c * 2 + 2), sEvensAvx2(in + c * 2 + 4));
+		sStoreAvx2(out_hp + c, _mm256_add_epi16(sOddsAvx2(in + c * 2), p));
+	}
+	_mm256_zeroupper();
+	return sHpInterleavedSse2(c, end, in, out_hp);
+}
+
+AKO_TARGET_AVX2 static size_t sLpInterleavedAvx2(size_t c, size_t end, const int16_t* in, const int16_t* hp,
+                                                 int16_t* out_lp)
+{
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i u =
+		    sUpdateAvx2(sLoadAvx2(hp + c - 2), sLoadAvx2(hp + c - 1), sLoadAvx2(hp + c), sLoadAvx2(hp + c + 1));
+		sStoreAvx2(out_lp + c, _mm256_add_epi16(sEvensAvx2(in + c * 2), u));
+	}
+	_mm256_zeroupper();
+	return sLpInterleavedSse2(c, end, in, hp, out_lp);
+}
+
+AKO_TARGET_AVX2 static size_t sUnliftInterleavedAvx2(size_t c, size_t end, const int16_t* lp, const int16_t* hp,
+                                                     int16_t* out)
+{
+	__m256i prev = _mm256_inserti128_si256(
+	    _mm256_setzero_si256(), _mm_set_epi16(out[c * 2 - 2], out[c * 2 - 4], out[c * 2 - 6], 0, 0, 0, 0, 0), 1);
+	__m256i even = prev;
+
+	for (; c + 16 <= end; c += 16)
+	{
+		const __m256i u =
+		    sUpdateAvx2(sLoadAvx2(hp + c - 2), sLoadAvx2(hp + c - 1), sLoadAvx2(hp + c), sLoadAvx2(hp + c + 1));
+		even = _mm256_sub_epi16(sLoadAvx2(lp + c), u);
+
+		// Alignr works per 128 bits lane, so it needs previous high lane next to current low one
+		const __m256i cross = _mm256_permute2x128_si256(prev, even, 0x21);
+		const __m256i even_l1 = _mm256_alignr_epi8(even, cross, 14);
+		const __m256i even_l2 = _mm256_alignr_epi8(even, cross, 12);
+		const __m256i even_l3 = _mm256_alignr_epi8(even, cross, 10);
+		const __m256i odd_l2 =
+		    _mm256_sub_epi16(sLoadAvx2(hp + c - 2), sPredictAvx2(even_l3, even_l2, even_l1, even));
+
+		const __m256i lo = _mm256_unpacklo_epi16(even_l2, odd_l2);
+		const __m256i hi = _mm256_unpackhi_epi16(even_l2, odd_l2);
+		sStoreAvx2(out + c * 2 - 4, _mm256_permute2x128_si256(lo, hi, 0x20));
+		sStoreAvx2(out + c * 2 + 12, _mm256_permute2x128_si256(lo, hi, 0x31));
+		prev = even;
+	}
+
+	out[c * 2 - 4] = (int16_t)_mm256_extract_epi16(even, 14);
+	out[c * 2 - 2] = (int16_t)_mm256_extract_epi16(even, 15);
+	_mm256_zeroupper();
+	return sUnliftInterleavedSse2(c, end, lp, hp, out);
+}
+
+
+AKO_TARGET_AVX512 static inline __m512i sLoadAvx512(const int16_t* p)
+{
+	return _mm512_loadu_si512((const void*)p);
+}
+
+AKO_TARGET_AVX512 static inline void sStoreAvx512(int16_t* p, __m512i v)
+{
+	_mm512_storeu_si512((void*)p, v);
+}
+
+AKO_TARGET_AVX512 static inline __m512i sDequantizeAvx512(__m512i v, __m512i q)
+{
+	return _mm512_mullo_epi16(v, q); // Lowest 16 bits, as C does
+}
+
+AKO_TARGET_AVX512 static inline __m512i sDivideAvx512(__m512i x, int shift)
+{
+	const __m512i bias = _mm512_srli_epi32(_mm512_srai_epi32(x, 31), 32 - shift);
+	return _mm512_srai_epi32(_mm512_add_epi32(x, bias), shift);
+}
+
+AKO_TARGET_AVX512 static inline __m512i sTapsAvx512(__m512i a, __m512i b, __m512i c, __m512i d, __m512i weights,
+                                                    int shift)
+{
+	const __m512i lo = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), weights),
+	                                    _mm512_madd_epi16(_mm512_unpacklo_epi16(d, c), weights));
+	const __m512i hi = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), weights),
+	                                    _mm512_madd_epi16(_mm512_unpackhi_epi16(d, c), weights));
+
+	return _mm512_packs_epi32(_mm512_srai_epi32(_mm512_slli_epi32(sDivideAvx512(lo, shift), 16), 16),
+	                          _mm512_srai_epi32(_mm512_slli_epi32(sDivideAvx512(hi, shift), 16), 16));
+}
+
+AKO_TARGET_AVX512 static inline __m512i sPredictAvx512(__m512i even_l1, __m512i even, __m512i even_p1,
+                                                       __m512i even_p2)
+{
+	return sTapsAvx512(even_l1, even, even_p1, even_p2, _mm512_set1_epi32((int32_t)0xFFF70001), 4);
+}
+
+AKO_TARGET_AVX512 static inline __m512i sUpdateAvx512(__m512i hp_l2, __m512i hp_l1, __m512i hp, __m512i hp_p1)
+{
+	return sTapsAvx512(hp_l2, hp_l1, hp, hp_p1, _mm512_set1_epi32((int32_t)0x0009FFFF), 5);
+}
+
+AKO_TARGET_AVX512 static size_t sHpRowAvx512(size_t c, size_t end, const int16_t* odd, const int16_t* even_l1,
+                                             const int16_t* even, const int16_t* even_p1, const int16_t* even_p2,
+                                             int16_t* out)
+{
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i p = sPredictAvx512(sLoadAvx512(even_l1 + c), sLoadAvx512(even + c),
+		                                 sLoadAvx512(even_p1 + c), sLoadAvx512(even_p2 + c));
+		sStoreAvx512(out + c, _mm512_add_epi16(sLoadAvx512(odd + c), p));
+	}
+	return sHpRowAvx2(c, end, odd, even_l1, even, even_p1, even_p2, out);
+}
+
+AKO_TARGET_AVX512 static size_t sLpRowAvx512(size_t c, size_t end, const int16_t* even, const int16_t* hp_l2,
+                                             const int16_t* hp_l1, const int16_t* hp, const int16_t* hp_p1,
+                                             int16_t* out)
+{
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i u = sUpdateAvx512(sLoadAvx512(hp_l2 + c), sLoadAvx512(hp_l1 + c), sLoadAvx512(hp + c),
+		                                sLoadAvx512(hp_p1 + c));
+		sStoreAvx512(out + c, _mm512_add_epi16(sLoadAvx512(even + c), u));
+	}
+	return sLpRowAvx2(c, end, even, hp_l2, hp_l1, hp, hp_p1, out);
+}
+
+AKO_TARGET_AVX512 static size_t sEvenRowAvx512(size_t c, size_t end, int16_t lp_q, int16_t hp_q, const int16_t* lp,
+                                               const int16_t* hp_l2, const int16_t* hp_l1, const int16_t* hp,
+                                               const int16_t* hp_p1, int16_t* out)
+{
+	const __m512i lp_q_v = _mm512_set1_epi16(lp_q);
+	const __m512i hp_q_v = _mm512_set1_epi16(hp_q);
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i hp_l2_v = sDequantizeAvx512(sLoadAvx512(hp_l2 + c), hp_q_v);
+		const __m512i hp_l1_v = sDequantizeAvx512(sLoadAvx512(hp_l1 + c), hp_q_v);
+		const __m512i hp_v = sDequantizeAvx512(sLoadAvx512(hp + c), hp_q_v);
+		const __m512i hp_p1_v = sDequantizeAvx512(sLoadAvx512(hp_p1 + c), hp_q_v);
+		const __m512i u = sUpdateAvx512(hp_l2_v, hp_l1_v, hp_v, hp_p1_v);
+		sStoreAvx512(out + c, _mm512_sub_epi16(sDequantizeAvx512(sLoadAvx512(lp + c), lp_q_v), u));
+	}
+	return sEvenRowAvx2(c, end, lp_q, hp_q, lp, hp_l2, hp_l1, hp, hp_p1, out);
+}
+
+AKO_TARGET_AVX512 static size_t sOddRowAvx512(size_t c, size_t end, int16_t hp_q, const int16_t* hp,
+                                              const int16_t* even_l1, const int16_t* even, const int16_t* even_p1,
+                                              const int16_t* even_p2, int16_t* out)
+{
+	const __m512i hp_q_v = _mm512_set1_epi16(hp_q);
+	for (; c + 32 <= end; c += 32)
+	{
+		const __m512i p = sPredictAvx512(sLoadAvx512(even_l1 + c), sLoadAvx512(even + c),
+		                                 sLoadAvx512(even_p1 + c), sLoadAvx512(even_p2 + c));
+		sStoreAvx512(out + c, _mm512_sub_epi16(sDequantizeAvx512(sLoadAvx512(hp + c), hp_q_v), p));
+	}
+	return sOddRowAvx2(c, end, hp_q, hp, even_l1, even, even_p1, even_p2, out);
+}
+#endif
+
+
+static inline size_t sHpRow(const struct akoKernels* k, size_t c, size_t end, const int16_t* odd,
+                            const int16_t* even_l1, const int16_t* even, const int16_t* even_p1, const int16_t* even_p2,
+                            int16_t* out)
+{
+	if (k->dd137_hp_row != NULL)
+		c = k->dd137_hp_row(c, end, odd, even_l1, even, even_p1, even_p2, out);
+	return c;
+}
+
+static inline size_t sLpRow(const struct akoKernels* k, size_t c, size_t end, const int16_t* even, const int16_t* hp_l2,
+                            const int16_t* hp_l1, const int16_t* hp, const int16_t* hp_p1, int16_t* out)
+{
+	if (k->dd137_lp_row != NULL)
+		c = k->dd137_lp_row(c, end, even, hp_l2, hp_l1, hp, hp_p1, out);
+	return c;
+}
+
+static inline size_t sEvenRow(const struct akoKernels* k, size_t c, size_t end, int16_t lp_q, int16_t hp_q,
+                              const int16_t* lp, const int16_t* hp_l2, const int16_t* hp_l1, const int16_t* hp,
+                              const int16_t* hp_p1, int16_t* out)
+{
+	if (k->dd137_even_row != NULL)
+		c = k->dd137_even_row(c, end, lp_q, hp_q, lp, hp_l2, hp_l1, hp, hp_p1, out);
+	return c;
+}
+
+static inline size_t sOddRow(const struct akoKernels* k, size_t c, size_t end, int16_t hp_q, const int16_t* hp,
+                             const int16_t* even_l1, const int16_t* even, const int16_t* even_p1,
+                             const int16_t* even_p2, int16_t* out)
+{
+	if (k->dd137_odd_row != NULL)
+		c = k->dd137_odd_row(c, end, hp_q, hp, even_l1, even, even_p1, even_p2, out);
+	return c;
+}
+
+static inline size_t sHpInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* in,
+                                    int16_t* out_hp)
+{
+	if (k->dd137_hp_interleaved != NULL)
+		c = k->dd137_hp_interleaved(c, end, in, out_hp);
+	return c;
+}
+
+static inline size_t sLpInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* in,
+                                    const int16_t* hp, int16_t* out_lp)
+{
+	if (k->dd137_lp_interleaved != NULL)
+		c = k->dd137_lp_interleaved(c, end, in, hp, out_lp);
+	return c;
+}
+
+static inline size_t sUnliftInterleaved(const struct akoKernels* k, size_t c, size_t end, const int16_t* lp,
+                                        const int16_t* hp, int16_t* out)
+{
+	if (k->dd137_unlift_interleaved != NULL)
+		c = k->dd137_unlift_interleaved(c, end, lp, hp, out);
+	return c;
+}
+
+
+void akoDd137Kernels(enum akoSimd simd, struct akoKernels* k)
+{
+	k->dd137_hp_row = NULL;
+	k->dd137_lp_row = NULL;
+	k->dd137_even_row = NULL;
+	k->dd137_odd_row = NULL;
+	k->dd137_hp_interleaved = NULL;
+	k->dd137_lp_interleaved = NULL;
+	k->dd137_unlift_interleaved = NULL;
+
+#if (AKO_SIMD_X86 == 1)
+	if (simd >= AKO_SIMD_SSE2) // Sse4.1 doesn't add anything here
+	{
+		k->dd137_hp_row = sHpRowSse2;
+		k->dd137_lp_row = sLpRowSse2;
+		k->dd137_even_row = sEvenRowSse2;
+		k->dd137_odd_row = sOddRowSse2;
+		k->dd137_hp_interleaved = sHpInterleavedSse2;
+		k->dd137_lp_interleaved = sLpInterleavedSse2;
+		k->dd137_unlift_interleaved = sUnliftInterleavedSse2;
+	}
+
+	if (simd >= AKO_SIMD_AVX2)
+	{
+		k->dd137_hp_row = sHpRowAvx2;
+		k->dd137_lp_row = sLpRowAvx2;
+		k->dd137_even_row = sEvenRowAvx2;
+		k->dd137_odd_row = sOddRowAvx2;
+		k->dd137_hp_interleaved = sHpInterleavedAvx2;
+		k->dd137_lp_interleaved = sLpInterleavedAvx2;
+		k->dd137_unlift_interleaved = sUnliftInterleavedAvx2;
+	}
+
+	if (simd >= AKO_SIMD_AVX512) // Only vertical passes, horizontal ones stay as Avx2
+	{
+		k->dd137_hp_row = sHpRowAvx512;
+		k->dd137_lp_row = sLpRowAvx512;
+		k->dd137_even_row = sEvenRowAvx512;
+		k->dd137_odd_row = sOddRowAvx512;
+	}
+#else
+	(void)simd;
+#endif
+}
+
 
 void akoDd137LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t fake_last, size_t in_stride,
                    const int16_t* in, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	for (size_t r = 0; r < current_h; r++)
 	{
 		// HP, first values
@@ -83,8 +658,10 @@ void akoDd137LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t
 			out[(r * target_w * 2) + (c + target_w)] = sHp(odd, even_l1, even, even_p1, even_p2);
 		}
 
-		// HP, middle values
-		for (size_t c = 1; c < (target_w - 2); c++)
+		// HP, middle values (vectors stop one before, as 'fake_last' means one value less to read)
+		for (size_t c = sHpInterleaved(k, 1, (target_w > 3) ? (target_w - 3) : 0, in + (r * in_stride),
+		                               out + (r * target_w * 2) + target_w);
+		     c < (target_w - 2); c++)
 		{
 			const int16_t even_l1 = in[(r * in_stride) + (c * 2 - 2)];
 			const int16_t even = in[(r * in_stride) + (c * 2 + 0)];
@@ -171,7 +748,9 @@ void akoDd137LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t
 		}
 
 		// LP, middle values
-		for (size_t c = 2; c < (target_w - 1); c++)
+		for (size_t c = sLpInterleaved(k, 2, target_w - 1, in + (r * in_stride), out + (r * target_w * 2) + target_w,
+		                               out + (r * target_w * 2));
+		     c < (target_w - 1); c++)
 		{
 			const int16_t even = in[(r * in_stride) + (c * 2 + 0)];
 			const int16_t hp_l2 = out[(r * target_w * 2) + (c + target_w - 2)];
@@ -211,6 +790,8 @@ void akoDd137LiftH(enum akoWrap wrap, size_t current_h, size_t target_w, size_t
 
 void akoDd137LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const int16_t* in, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	// HP, first values
 	for (size_t r = 0; r < 1; r++)
 	{
@@ -241,7 +822,10 @@ void akoDd137LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const in
 	// HP, middle values
 	for (size_t r = 1; r < (target_h - 2); r++)
 	{
-		for (size_t c = 0; c < target_w; c++)
+		for (size_t c = sHpRow(k, 0, target_w, in + (r * 2 + 1) * target_w, in + (r * 2 - 2) * target_w,
+		                       in + (r * 2 + 0) * target_w, in + (r * 2 + 2) * target_w, in + (r * 2 + 4) * target_w,
+		                       out + target_w * (target_h + r));
+		     c < target_w; c++)
 		{
 			const int16_t even_l1 = in[(r * 2 - 2) * target_w + c];
 			const int16_t even = in[(r * 2 + 0) * target_w + c];
@@ -332,7 +916,10 @@ void akoDd137LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const in
 	// LP, middle values
 	for (size_t r = 2; r < (target_h - 1); r++)
 	{
-		for (size_t c = 0; c < target_w; c++)
+		for (size_t c = sLpRow(k, 0, target_w, in + (r * 2 + 0) * target_w, out + target_w * (target_h + r - 2),
+		                       out + target_w * (target_h + r - 1), out + target_w * (target_h + r + 0),
+		                       out + target_w * (target_h + r + 1), out + (target_w * r));
+		     c < target_w; c++)
 		{
 			const int16_t even = in[(r * 2 + 0) * target_w + c];
 			const int16_t hp_l2 = out[target_w * (target_h + r - 2) + c];
@@ -378,6 +965,8 @@ void akoDd137LiftV(enum akoWrap wrap, size_t target_w, size_t target_h, const in
 void akoDd137UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size_t out_stride, size_t ignore_last,
                      const int16_t* in_lp, const int16_t* in_hp, int16_t* out)
 {
+	const struct akoKernels* k = akoKernels();
+
 	for (size_t r = 0; r < current_h; r++)
 	{
 		// Even, first values
@@ -450,7 +1039,10 @@ void akoDd137UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 		}
 
 		// Middle values
-		for (size_t c = (ODD_DELAY + 1); c < (current_w - 2); c++)
+		const size_t middle = sUnliftInterleaved(k, ODD_DELAY + 1, current_w - 2, in_lp + (r * current_w),
+		                                         in_hp + (r * current_w), out + (r * out_stride));
+
+		for (size_t c = middle; c < (current_w - 2); c++)
 		{
 			const int16_t lp = in_lp[(r * current_w) + (c + 0)];
 			const int16_t hp_l2 = in_hp[(r * current_w) + (c - 2)];
@@ -461,7 +1053,7 @@ void akoDd137UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 			out[(r * out_stride) + (c * 2 + 0)] = sEven(lp, hp_l2, hp_l1, hp, hp_p1);
 		}
 
-		for (size_t c = (ODD_DELAY + 1); c < (current_w - 2); c++)
+		for (size_t c = middle; c < (current_w - 2); c++)
 		{
 			const int16_t hp = in_hp[(r * current_w) + (c + 0) - ODD_DELAY];
 			const int16_t even_l1 = out[(r * out_stride) + (c * 2 - 2) - ODD_DELAY * 2];
@@ -537,39 +1129,41 @@ void akoDd137UnliftH(enum akoWrap wrap, size_t current_w, size_t current_h, size
 }
 
 
-void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t current_h, const int16_t* in_lp,
-                               const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp)
+void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q,
+                               const int16_t* in_lp, const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp)
 {
+	const struct akoKernels* k = akoKernels();
+
 	// Even, first values
 	for (size_t r = 0; r < 2; r++)
 	{
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(r + 0) * current_w + c];
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
-			const int16_t hp_p1 = in_hp[(r + 1) * current_w + c];
+			const int16_t lp = sDequantize(in_lp[(r + 0) * current_w + c], lp_q);
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
+			const int16_t hp_p1 = sDequantize(in_hp[(r + 1) * current_w + c], hp_q);
 
 			int16_t hp_l1;
 			if (r > 0)
-				hp_l1 = in_hp[(r - 1) * current_w + c];
+				hp_l1 = sDequantize(in_hp[(r - 1) * current_w + c], hp_q);
 			else
 				switch (wrap)
 				{
 				case AKO_WRAP_CLAMP: // falltrough
 				case AKO_WRAP_MIRROR: hp_l1 = hp; break;
-				case AKO_WRAP_REPEAT: hp_l1 = in_hp[(current_h - 1 + r) * current_w + c]; break;
+				case AKO_WRAP_REPEAT: hp_l1 = sDequantize(in_hp[(current_h - 1 + r) * current_w + c], hp_q); break;
 				case AKO_WRAP_ZERO: hp_l1 = 0; break;
 				}
 
 			int16_t hp_l2;
 			if (r > 1)
-				hp_l2 = in_hp[(r - 2) * current_w + c];
+				hp_l2 = sDequantize(in_hp[(r - 2) * current_w + c], hp_q);
 			else
 				switch (wrap)
 				{
 				case AKO_WRAP_CLAMP: hp_l2 = hp_l1; break;
 				case AKO_WRAP_MIRROR: hp_l2 = hp_p1; break;
-				case AKO_WRAP_REPEAT: hp_l2 = in_hp[(current_h - 2 + r) * current_w + c]; break;
+				case AKO_WRAP_REPEAT: hp_l2 = sDequantize(in_hp[(current_h - 2 + r) * current_w + c], hp_q); break;
 				case AKO_WRAP_ZERO: hp_l2 = 0; break;
 				}
 
@@ -581,13 +1175,16 @@ void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	// Even, middle values
 	for (size_t r = 2; r < (current_h - 2); r++)
 	{
-		for (size_t c = 0; c < current_w; c++)
+		for (size_t c = sEvenRow(k, 0, current_w, lp_q, hp_q, in_lp + (r + 0) * current_w, in_hp + (r - 2) * current_w,
+		                         in_hp + (r - 1) * current_w, in_hp + (r + 0) * current_w, in_hp + (r + 1) * current_w,
+		                         out_lp + (r * current_w));
+		     c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(r + 0) * current_w + c];
-			const int16_t hp_l2 = in_hp[(r - 2) * current_w + c];
-			const int16_t hp_l1 = in_hp[(r - 1) * current_w + c];
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
-			const int16_t hp_p1 = in_hp[(r + 1) * current_w + c];
+			const int16_t lp = sDequantize(in_lp[(r + 0) * current_w + c], lp_q);
+			const int16_t hp_l2 = sDequantize(in_hp[(r - 2) * current_w + c], hp_q);
+			const int16_t hp_l1 = sDequantize(in_hp[(r - 1) * current_w + c], hp_q);
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
+			const int16_t hp_p1 = sDequantize(in_hp[(r + 1) * current_w + c], hp_q);
 
 			out_lp[(r * current_w) + c] = sEven(lp, hp_l2, hp_l1, hp, hp_p1);
 		}
@@ -598,20 +1195,20 @@ void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	{
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(r + 0) * current_w + c];
-			const int16_t hp_l2 = in_hp[(r - 2) * current_w + c];
-			const int16_t hp_l1 = in_hp[(r - 1) * current_w + c];
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t lp = sDequantize(in_lp[(r + 0) * current_w + c], lp_q);
+			const int16_t hp_l2 = sDequantize(in_hp[(r - 2) * current_w + c], hp_q);
+			const int16_t hp_l1 = sDequantize(in_hp[(r - 1) * current_w + c], hp_q);
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 
 			int16_t hp_p1;
 			if (r < current_h - 1)
-				hp_p1 = in_hp[(r + 1) * current_w + c];
+				hp_p1 = sDequantize(in_hp[(r + 1) * current_w + c], hp_q);
 			else
 				switch (wrap)
 				{
 				case AKO_WRAP_CLAMP: // falltrough
 				case AKO_WRAP_MIRROR: hp_p1 = hp; break;
-				case AKO_WRAP_REPEAT: hp_p1 = in_hp[c]; break;
+				case AKO_WRAP_REPEAT: hp_p1 = sDequantize(in_hp[c], hp_q); break;
 				case AKO_WRAP_ZERO: hp_p1 = 0; break;
 				}
 
@@ -625,7 +1222,7 @@ void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	{
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 			const int16_t even = out_lp[(r + 0) * current_w + c];
 			const int16_t even_p1 = out_lp[(r + 1) * current_w + c];
 			const int16_t even_p2 = out_lp[(r + 2) * current_w + c];
@@ -650,9 +1247,12 @@ void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	// Odd, middle values
 	for (size_t r = 1; r < (current_h - 2); r++)
 	{
-		for (size_t c = 0; c < current_w; c++)
+		for (size_t c = sOddRow(k, 0, current_w, hp_q, in_hp + (r + 0) * current_w, out_lp + (r - 1) * current_w,
+		                        out_lp + (r + 0) * current_w, out_lp + (r + 1) * current_w,
+		                        out_lp + (r + 2) * current_w, out_hp + (r * current_w));
+		     c < current_w; c++)
 		{
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 			const int16_t even_l1 = out_lp[(r - 1) * current_w + c];
 			const int16_t even = out_lp[(r + 0) * current_w + c];
 			const int16_t even_p1 = out_lp[(r + 1) * current_w + c];
@@ -667,7 +1267,7 @@ void akoDd137InPlaceishUnliftV(enum akoWrap wrap, size_t current_w, size_t curre
 	{
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t hp = in_hp[(r + 0) * current_w + c];
+			const int16_t hp = sDequantize(in_hp[(r + 0) * current_w + c], hp_q);
 			const int16_t even_l1 = out_lp[(r - 1) * current_w + c];
 			const int16_t even = out_lp[(r + 0) * current_w + c];
 
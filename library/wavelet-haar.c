@@ -96,15 +96,15 @@ void akoHaarUnliftH(size_t current_w, size_t current_h, size_t out_stride, size_
 }
 
 
-void akoHaarInPlaceishUnliftV(size_t current_w, size_t current_h, const int16_t* in_lp, const int16_t* in_hp,
-                              int16_t* out_lp, int16_t* out_hp)
+void akoHaarInPlaceishUnliftV(size_t current_w, size_t current_h, int16_t lp_q, int16_t hp_q, const int16_t* in_lp,
+                              const int16_t* in_hp, int16_t* out_lp, int16_t* out_hp)
 {
 	for (size_t r = 0; r < current_h; r++)
 	{
 		for (size_t c = 0; c < current_w; c++)
 		{
-			const int16_t lp = in_lp[(current_w * r) + c];
-			const int16_t hp = in_hp[(current_w * r) + c];
+			const int16_t lp = (int16_t)(in_lp[(current_w * r) + c] * lp_q); // Inverse quantization
+			const int16_t hp = (int16_t)(in_hp[(current_w * r) + c] * hp_q);
 
 			out_lp[(current_w * r) + c] = lp;                 // Even
 			out_hp[(current_w * r) + c] = (int16_t)(lp + hp); // Odd
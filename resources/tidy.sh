@@ -4,6 +4,7 @@ cflags="-std=c11 -Wall -Wextra -Wconversion -pedantic -I./library"
 
 cfiles="./library/compression-rle.c
         ./library/compression.c
+        ./library/cpu.c
         ./library/decode.c
         ./library/developer.c
         ./library/encode.c
@@ -13,6 +14,7 @@ cfiles="./library/compression-rle.c
         ./library/lifting.c
         ./library/misc.c
         ./library/quantization.c
+        ./library/threads.c
         ./library/version.c"
 
 clang-tidy-12 $cfiles -- $cflags
@@ -0,0 +1,354 @@
+#include "ako.h"
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static uint8_t* sImage(size_t channels, size_t image_w, size_t image_h)
+{
+	// Smooth, plus some noise
+	uint8_t* image = malloc(image_w * image_h * channels);
+	assert(image != NULL);
+
+	uint32_t x = 666;
+	for (size_t row = 0; row < image_h; row++)
+		for (size_t col = 0; col < image_w; col++)
+			for (size_t ch = 0; ch < channels; ch++)
+			{
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				image[(row * image_w + col) * channels + ch] = (uint8_t)((row + col) / 2 + ch * 30 + (x % 8));
+			}
+
+	return image;
+}
+
+
+struct sWritten
+{
+	size_t size;
+	uint8_t* data;
+};
+
+static void sWrite(size_t offset, size_t size, const void* data, void* user_data)
+{
+	struct sWritten* w = user_data;
+
+	if (offset + size > w->size)
+	{
+		w->data = realloc(w->data, offset + size);
+		assert(w->data != NULL);
+		w->size = offset + size;
+	}
+
+	memcpy(w->data + offset, data, size);
+}
+
+static void sStreamTest(size_t channels, size_t image_w, size_t image_h, size_t tiles_dimension, int tiles_index,
+                        size_t threads)
+{
+	printf("Stream test, %zu channels, %zux%zu px, tiles: %zu, index: %i, threads: %zu\n", channels, image_w,
+	       image_h, tiles_dimension, tiles_index, threads);
+
+	uint8_t* input = sImage(channels, image_w, image_h);
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.tiles_index = tiles_index;
+	s.quantization = 8;
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.threads = threads;
+
+	void* blob = NULL;
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, image_w, image_h, input, &blob, NULL);
+	assert(blob_size != 0);
+
+	// Rows in uneven chunks, one, two, three... should write the same as akoEncodeExt()
+	struct sWritten written = {0, NULL};
+	enum akoStatus status = AKO_ERROR;
+
+	struct akoEncoder* e = akoEncoderBegin(&c, &s, channels, image_w, image_h, sWrite, &written, &status);
+	assert(e != NULL);
+	assert(status == AKO_OK);
+
+	for (size_t row = 0, chunk = 1; row < image_h; row += chunk, chunk++)
+	{
+		const size_t rows_no = (image_h - row < chunk) ? (image_h - row) : chunk;
+		assert(akoEncoderPushRows(e, rows_no, input + row * image_w * channels) == AKO_OK);
+	}
+
+	assert(akoEncoderFinish(e, &status) == blob_size);
+	assert(status == AKO_OK);
+	assert(written.size == blob_size);
+	assert(memcmp(written.data, blob, blob_size) == 0);
+
+	// Incomplete images, and no encoder at all, are errors
+	e = akoEncoderBegin(&c, &s, channels, image_w, image_h, sWrite, &written, &status);
+	assert(e != NULL);
+	assert(akoEncoderPushRows(e, image_h - 1, input) == AKO_OK);
+	assert(akoEncoderFinish(e, &status) == 0);
+	assert(status == AKO_INVALID_INPUT);
+
+	assert(akoEncoderPushRows(NULL, 1, input) == AKO_INVALID_INPUT);
+	assert(akoEncoderFinish(NULL, &status) == 0);
+	assert(status == AKO_INVALID_INPUT);
+
+	// Bye!
+	free(written.data);
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+static void sScaledTest(enum akoWavelet wavelet, size_t channels, size_t image_w, size_t image_h,
+                        size_t tiles_dimension)
+{
+	printf("Scaled test, wavelet: %i, %zu channels, %zux%zu px, tiles: %zu\n", wavelet, channels, image_w, image_h,
+	       tiles_dimension);
+
+	uint8_t* input = sImage(channels, image_w, image_h);
+
+	struct akoSettings s = akoDefaultSettings();
+	s.wavelet = wavelet;
+	s.color = AKO_COLOR_NONE;
+	s.tiles_dimension = tiles_dimension;
+
+	void* blob = NULL;
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, image_w, image_h, input, &blob, NULL);
+	assert(blob_size != 0);
+
+	for (size_t scale = 0; scale <= AKO_MAX_SCALE; scale++)
+	{
+		size_t out_w = 0;
+		size_t out_h = 0;
+		enum akoStatus status = AKO_ERROR;
+		uint8_t* image = akoDecodeScaled(NULL, blob_size, blob, scale, NULL, NULL, &out_w, &out_h, &status);
+		assert(image != NULL);
+		assert(status == AKO_OK);
+
+		// Dimensions rounded up
+		const size_t factor = (size_t)1 << scale;
+		assert(out_w == (image_w + factor - 1) / factor);
+		assert(out_h == (image_h + factor - 1) / factor);
+
+		// Values near the input average, exactly without wavelet (as it is lossless here)
+		const int tolerance = (wavelet == AKO_WAVELET_NONE) ? 1 : 12;
+
+		for (size_t row = 0; row < out_h; row++)
+			for (size_t col = 0; col < out_w; col++)
+				for (size_t ch = 0; ch < channels; ch++)
+				{
+					int sum = 0;
+					int n = 0;
+					for (size_t r = row * factor; r < row * factor + factor && r < image_h; r++)
+						for (size_t c = col * factor; c < col * factor + factor && c < image_w; c++, n++)
+							sum += input[(r * image_w + c) * channels + ch];
+
+					const int v = image[(row * out_w + col) * channels + ch];
+					assert(v >= (sum + n / 2) / n - tolerance && v <= (sum + n / 2) / n + tolerance);
+				}
+
+		akoDefaultFree(image);
+	}
+
+	assert(akoDecodeScaled(NULL, blob_size, blob, AKO_MAX_SCALE + 1, NULL, NULL, NULL, NULL, NULL) == NULL);
+
+	// Bye!
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+struct sRows
+{
+	size_t next_row;
+	size_t image_size;
+	uint8_t* image;
+};
+
+static void sRowsCallback(size_t row, size_t rows_no, size_t stride, const uint8_t* data, void* user_data)
+{
+	struct sRows* r = user_data;
+
+	assert(row == r->next_row); // In order, top to bottom
+	assert((row + rows_no) * stride <= r->image_size);
+
+	memcpy(r->image + row * stride, data, rows_no * stride);
+	r->next_row = row + rows_no;
+}
+
+static void sRowsTest(size_t channels, size_t image_w, size_t image_h, size_t tiles_dimension, size_t threads)
+{
+	printf("Rows test, %zu channels, %zux%zu px, tiles: %zu, threads: %zu\n", channels, image_w, image_h,
+	       tiles_dimension, threads);
+
+	uint8_t* input = sImage(channels, image_w, image_h);
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.quantization = 8;
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.threads = threads;
+
+	void* blob = NULL;
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, image_w, image_h, input, &blob, NULL);
+	assert(blob_size != 0);
+
+	uint8_t* image = akoDecodeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, NULL);
+	assert(image != NULL);
+
+	// Rows should add up to a full decode
+	struct sRows r = {0, image_w * image_h * channels, malloc(image_w * image_h * channels)};
+	assert(r.image != NULL);
+
+	size_t out_w = 0;
+	size_t out_h = 0;
+	assert(akoDecodeRows(&c, blob_size, blob, sRowsCallback, &r, NULL, NULL, &out_w, &out_h) == AKO_OK);
+	assert(out_w == image_w && out_h == image_h);
+	assert(r.next_row == image_h);
+	assert(memcmp(r.image, image, image_w * image_h * channels) == 0);
+
+	// Bye!
+	free(r.image);
+	akoDefaultFree(image);
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+static void sIntoTest(size_t channels, size_t image_w, size_t image_h, size_t tiles_dimension, int tiles_index)
+{
+	printf("Into test, %zu channels, %zux%zu px, tiles: %zu, index: %i\n", channels, image_w, image_h,
+	       tiles_dimension, tiles_index);
+
+	uint8_t* input = sImage(channels, image_w, image_h);
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.tiles_index = tiles_index;
+
+	void* blob = NULL;
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, image_w, image_h, input, &blob, NULL);
+	assert(blob_size != 0);
+
+	// A buffer of akoEncodeBound() never fails for space, and outputs the same as akoEncodeExt()
+	const size_t bound = akoEncodeBound(&s, channels, image_w, image_h);
+	assert(bound >= blob_size);
+
+	uint8_t* buffer = malloc(bound + 1);
+	assert(buffer != NULL);
+	buffer[bound] = 0xAA;
+
+	enum akoStatus status = AKO_ERROR;
+	assert(akoEncodeInto(NULL, &s, channels, image_w, image_h, 0, input, bound, buffer, &status) == blob_size);
+	assert(status == AKO_OK);
+	assert(memcmp(buffer, blob, blob_size) == 0);
+	assert(buffer[bound] == 0xAA);
+
+	// Without space it should fail, not overflow
+	buffer[blob_size / 2] = 0xAA;
+	assert(akoEncodeInto(NULL, &s, channels, image_w, image_h, 0, input, blob_size / 2, buffer, &status) == 0);
+	assert(status == AKO_NO_ENOUGH_MEMORY);
+	assert(buffer[blob_size / 2] == 0xAA);
+
+	// Bye!
+	free(buffer);
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+static void sContextTest(size_t threads)
+{
+	printf("Context test, threads: %zu\n", threads);
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.threads = threads;
+
+	enum akoStatus status = AKO_ERROR;
+	struct akoEncodeContext* ectx = akoEncodeContextCreate(&c, &status);
+	struct akoDecodeContext* dctx = akoDecodeContextCreate(&c, &status);
+	assert(ectx != NULL && dctx != NULL);
+
+	// Growing and shrinking sizes, tiles and channels, on the same contexts
+	const size_t cases[][4] = {{3, 64, 48, 0},   {4, 200, 120, 32}, {1, 17, 9, 0},
+	                           {3, 300, 10, 16}, {2, 64, 48, 64},   {4, 200, 120, 0}};
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		const size_t channels = cases[i][0];
+		const size_t image_w = cases[i][1];
+		const size_t image_h = cases[i][2];
+
+		uint8_t* input = sImage(channels, image_w, image_h);
+
+		struct akoSettings s = akoDefaultSettings();
+		s.tiles_dimension = cases[i][3];
+		s.quantization = 4;
+
+		// Should be the same as without contexts
+		void* blob = NULL;
+		const size_t blob_size = akoEncodeExt(&c, &s, channels, image_w, image_h, input, &blob, NULL);
+		assert(blob_size != 0);
+
+		uint8_t* image = akoDecodeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, NULL);
+		assert(image != NULL);
+
+		const size_t bound = akoEncodeBound(&s, channels, image_w, image_h);
+		uint8_t* buffer = malloc(bound);
+		uint8_t* canvas = malloc(image_w * image_h * channels);
+		assert(buffer != NULL && canvas != NULL);
+
+		assert(akoEncodeWithContext(ectx, &s, channels, image_w, image_h, 0, input, bound, buffer, &status) ==
+		       blob_size);
+		assert(memcmp(buffer, blob, blob_size) == 0);
+
+		assert(akoDecodeWithContext(dctx, blob_size, buffer, 0, 0, canvas, NULL, NULL, NULL, NULL) == AKO_OK);
+		assert(memcmp(canvas, image, image_w * image_h * channels) == 0);
+
+		free(canvas);
+		free(buffer);
+		akoDefaultFree(image);
+		akoDefaultFree(blob);
+		free(input);
+	}
+
+	// Bye!
+	akoEncodeContextDelete(ectx);
+	akoDecodeContextDelete(dctx);
+}
+
+
+int main()
+{
+	sStreamTest(3, 100, 80, 0, 0, 1); // No tiles, a single band
+	sStreamTest(3, 100, 80, 16, 0, 1);
+	sStreamTest(4, 130, 70, 16, 1, 3);
+	sStreamTest(1, 256, 100, 32, 1, 4);
+
+	sScaledTest(AKO_WAVELET_NONE, 3, 100, 80, 0);
+	sScaledTest(AKO_WAVELET_NONE, 1, 67, 45, 32);
+	sScaledTest(AKO_WAVELET_DD137, 3, 100, 80, 0);
+	sScaledTest(AKO_WAVELET_CDF53, 4, 130, 70, 16);
+	sScaledTest(AKO_WAVELET_HAAR, 3, 67, 45, 32);
+
+	sRowsTest(3, 100, 80, 0, 1);
+	sRowsTest(4, 130, 70, 16, 1);
+	sRowsTest(3, 130, 70, 16, 4);
+	sRowsTest(1, 67, 45, 32, 2);
+
+	sIntoTest(3, 100, 80, 0, 0);
+	sIntoTest(4, 130, 70, 16, 1);
+	sIntoTest(2, 67, 45, 32, 0);
+
+	sContextTest(1);
+	sContextTest(3);
+
+	return 0;
+}
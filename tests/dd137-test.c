@@ -185,7 +185,7 @@ static void sVerticalTest(size_t height, int16_t callback_data, int16_t (*callba
 		sVerticalPrint(sMin(height / 2, PRINT_MAX / 2), width, 1, "Hp:\t", "\t\t", buffer_b + (width * (height / 2)));
 
 		// Inverse DWT (in place in buffer b)
-		akoDd137InPlaceishUnliftV(w, width, height / 2, buffer_b, buffer_b + (width * (height / 2)), buffer_b,
+		akoDd137InPlaceishUnliftV(w, width, height / 2, 1, 1, buffer_b, buffer_b + (width * (height / 2)), buffer_b,
 		                          buffer_b + (width * (height / 2)));
 
 		// Copy as row (buffer b to c)
@@ -222,6 +222,72 @@ static void sVerticalTest(size_t height, int16_t callback_data, int16_t (*callba
 }
 
 
+static void sSimdTest(size_t width, size_t height, int16_t callback_data, int16_t (*callback)(size_t, int16_t, int16_t))
+{
+	// Every Simd level should output the same as plain C code, for every kernel. Widths
+	// here are in values, leaving tails of every length after the vectorized interiors
+	assert((width % 2) == 0 && (height % 2) == 0);
+
+	const size_t len = width * height;
+	int16_t* input = malloc(len * sizeof(int16_t));
+	int16_t* reference = malloc(len * 4 * sizeof(int16_t));
+	int16_t* output = malloc(len * 4 * sizeof(int16_t));
+	assert(input != NULL);
+	assert(reference != NULL);
+	assert(output != NULL);
+
+	printf("\n# Dd137 Simd (%zux%zu):\n", width, height);
+
+	// Generate data, wider than what the other tests use
+	{
+		int16_t value = 0;
+		for (size_t i = 0; i < len; i++)
+		{
+			value = callback(i, value, callback_data);
+			input[i] = (int16_t)(value * 32 - 1024);
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		const enum akoWrap wr = (enum akoWrap)i;
+
+		for (int simd = AKO_SIMD_NONE; simd <= (int)akoSimdDetected(); simd++)
+		{
+			if (akoSimdLimit((enum akoSimd)simd) != (enum akoSimd)simd)
+				continue;
+
+			int16_t* out = (simd == AKO_SIMD_NONE) ? reference : output;
+
+			// Lifts, unlifts using halves of the input as lowpass and highpass
+			akoDd137LiftH(wr, height, width / 2, 0, width, input, out + len * 0);
+			akoDd137LiftV(wr, width, height / 2, input, out + len * 1);
+			akoDd137UnliftH(wr, width / 2, height, width, 0, input, input + len / 2, out + len * 2);
+			akoDd137InPlaceishUnliftV(wr, width, height / 2, 3, 5, input, input + len / 2, out + len * 3,
+			                          out + len * 3 + len / 2);
+
+			if (simd != AKO_SIMD_NONE)
+			{
+				printf("[wrap %i, simd %i]\n", i, simd);
+				for (size_t p = 0; p < 4; p++)
+				{
+					if (memcmp(reference + len * p, output + len * p, len * sizeof(int16_t)) != 0)
+						printf("Error in pass %zu\n", p);
+
+					assert(memcmp(reference + len * p, output + len * p, len * sizeof(int16_t)) == 0);
+				}
+			}
+		}
+	}
+
+	akoSimdLimit(akoSimdDetected());
+
+	free(input);
+	free(reference);
+	free(output);
+}
+
+
 static int16_t sCallbackLinear(size_t i, int16_t prev, int16_t callback_data)
 {
 	(void)prev;
@@ -263,5 +329,10 @@ int main()
 	sVerticalTest(300, 5, sCallbackRandom);
 #endif
 
+	sSimdTest(16, 16, 5, sCallbackRandom);
+	sSimdTest(150, 22, 5, sCallbackRandom);
+	sSimdTest(98, 16, 6, sCallbackRandom);
+	sSimdTest(512, 18, 7, sCallbackRandom);
+
 	return 0;
 }
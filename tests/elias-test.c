@@ -5,6 +5,7 @@
 #include "ako-private.h"
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 
 static void sTest(size_t len, size_t buffer_size, uint16_t callback_data,
@@ -86,6 +87,55 @@ static uint16_t sCallbackRandom(size_t i, uint16_t prev, uint16_t callback_data)
 }
 
 
+static void sRunTest(uint16_t run, size_t no, int valid)
+{
+	// Kagari stream of a single band, eight values (no wavelet, one channel, 8x1 px): order
+	// zero, two zeros (both coded as one) and a run of 'run' more. Runs going beyond
+	// the band are broken input, except when decoding a prefix shorter than the band
+	uint8_t buffer[64];
+	int16_t output[8];
+
+	printf("Run test, run: %u, decoding: %zu values\n", run, no);
+
+	size_t encoded_size = 0;
+	{
+		struct akoEliasState e = {0};
+		uint8_t* out = buffer;
+
+		assert(akoEliasEncodeStep(&e, 1, &out, buffer + sizeof(buffer)) != 0); // Order + 1
+		assert(akoEliasEncodeStep(&e, 1, &out, buffer + sizeof(buffer)) != 0);
+		assert(akoEliasEncodeStep(&e, 1, &out, buffer + sizeof(buffer)) != 0);
+		assert(akoEliasEncodeStep(&e, (uint16_t)(run + 1), &out, buffer + sizeof(buffer)) != 0);
+
+		encoded_size = akoEliasEncodeEnd(&e, &out, buffer + sizeof(buffer), buffer);
+		assert(encoded_size != 0);
+	}
+
+	// A valid run should be what the encoder outputs
+	if (run == 6)
+	{
+		const int16_t zeros[8] = {0};
+		uint8_t encoded[64];
+		assert(akoKagariEncode(AKO_WAVELET_NONE, 1, 8, 1, sizeof(zeros), sizeof(encoded), zeros, encoded) ==
+		       encoded_size);
+		assert(memcmp(encoded, buffer, encoded_size) == 0);
+	}
+
+	const size_t decoded_size =
+	    akoKagariDecode(AKO_WAVELET_NONE, 1, 8, 1, no, encoded_size, sizeof(output), buffer, output);
+
+	if (valid == 0)
+	{
+		assert(decoded_size == 0);
+		return;
+	}
+
+	assert(decoded_size == encoded_size);
+	for (size_t i = 0; i < no; i++)
+		assert(output[i] == 0);
+}
+
+
 int main()
 {
 	sTest(8, 512, 1, sCallbackLinear);
@@ -98,5 +148,11 @@ int main()
 
 	sTest(8, 512, 1, sCallbackLinear);
 
+	sRunTest(6, 8, 1);  // Exactly to the band end
+	sRunTest(3, 5, 1);  // Shorter than the band, decoding a prefix
+	sRunTest(7, 8, 0);  // One beyond
+	sRunTest(200, 8, 0);
+	sRunTest(200, 4, 1); // Band cut by the prefix, the run can't be checked
+
 	return 0;
 }
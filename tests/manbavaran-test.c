@@ -0,0 +1,113 @@
+#undef NDEBUG
+
+#include "ako-private.h"
+#include <assert.h>
+#include <stdio.h>
+
+
+static void sTest(size_t len, int16_t callback_data, int16_t (*callback)(size_t, int16_t, int16_t))
+{
+	printf("Manbavaran test, %zu values\n", len);
+
+	// Worst case, every value with sixteen bits plus its token, and tables
+	const size_t buffer_size = len * sizeof(int16_t) * 2 + 512;
+
+	int16_t* input = malloc(len * sizeof(int16_t));
+	int16_t* output = malloc(len * sizeof(int16_t));
+	uint8_t* buffer = malloc(buffer_size);
+	assert(input != NULL && output != NULL && buffer != NULL);
+
+	int16_t value = 0;
+	for (size_t i = 0; i < len; i++)
+		input[i] = value = callback(i, value, callback_data);
+
+	// Encode
+	const size_t encoded_size = akoManbavaranEncode(len * sizeof(int16_t), buffer_size, input, buffer);
+	printf("E %zu -> %zu total bytes\n", len * sizeof(int16_t), encoded_size);
+	assert(encoded_size != 0);
+
+	// Without space it should fail, not overflow
+	assert(akoManbavaranEncode(len * sizeof(int16_t), encoded_size - 1, input, buffer + encoded_size) == 0);
+
+	// Decode, whole block
+	assert(akoManbavaranDecode(len, encoded_size, len * sizeof(int16_t), buffer, output) == encoded_size);
+	for (size_t i = 0; i < len; i++)
+		assert(output[i] == input[i]);
+
+	// Decode, prefixes
+	const size_t prefixes[] = {1, len / 2, len - 1};
+	for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++)
+	{
+		if (prefixes[p] == 0)
+			continue;
+
+		for (size_t i = 0; i < len; i++)
+			output[i] = 0;
+
+		const size_t read = akoManbavaranDecode(prefixes[p], encoded_size, len * sizeof(int16_t), buffer, output);
+		assert(read != 0 && read <= encoded_size);
+
+		for (size_t i = 0; i < prefixes[p]; i++)
+			assert(output[i] == input[i]);
+	}
+
+	// Truncated
+	assert(akoManbavaranDecode(len, encoded_size - 1, len * sizeof(int16_t), buffer, output) == 0);
+
+	printf("\n");
+	free(buffer);
+	free(output);
+	free(input);
+}
+
+
+static int16_t sCallbackConstant(size_t i, int16_t prev, int16_t callback_data)
+{
+	return callback_data;
+}
+
+static int16_t sCallbackLinear(size_t i, int16_t prev, int16_t callback_data)
+{
+	return (int16_t)(uint16_t)(i * (size_t)callback_data);
+}
+
+static int16_t sCallbackRandom(size_t i, int16_t prev, int16_t callback_data)
+{
+	uint16_t x = (uint16_t)((uint16_t)prev + (uint16_t)callback_data + (uint16_t)i);
+	x ^= (uint16_t)(x << 7);
+	x ^= (uint16_t)(x >> 9);
+	x ^= (uint16_t)(x << 8);
+	return (int16_t)x;
+}
+
+static int16_t sCallbackExtremes(size_t i, int16_t prev, int16_t callback_data)
+{
+	return ((i % 3) == 0) ? INT16_MIN : ((i % 3) == 1) ? INT16_MAX : 0;
+}
+
+static int16_t sCallbackSmall(size_t i, int16_t prev, int16_t callback_data)
+{
+	// Mostly zeros, as quantized highpasses
+	return ((i % 7) == 0) ? (int16_t)((int)(sCallbackRandom(i, prev, callback_data) % callback_data)) : 0;
+}
+
+
+int main()
+{
+	sTest(1, 0, sCallbackConstant); // All zeros
+	sTest(4096, 0, sCallbackConstant);
+
+	sTest(1, 1, sCallbackLinear); // Tiny blocks, under and around the interleaved states number
+	sTest(3, 1, sCallbackLinear);
+	sTest(4, -5, sCallbackLinear);
+	sTest(5, 300, sCallbackLinear);
+
+	sTest(65536, 1, sCallbackLinear); // Full int16 range
+	sTest(4096, 666, sCallbackRandom);
+	sTest(999, 0, sCallbackExtremes);
+
+	sTest(4096, 9, sCallbackSmall);
+	sTest(4097, 200, sCallbackSmall);
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include "ako.h"
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void sTest(size_t channels, size_t image_w, size_t image_h, size_t tiles_dimension, int tiles_index,
+                  size_t threads, size_t x, size_t y, size_t w, size_t h)
+{
+	printf("Region test, %zu channels, %zux%zu px, tiles: %zu, index: %i, threads: %zu, region: %zu:%zu %zux%zu\n",
+	       channels, image_w, image_h, tiles_dimension, tiles_index, threads, x, y, w, h);
+
+	// Something to encode
+	uint8_t* input = malloc(image_w * image_h * channels);
+	assert(input != NULL);
+
+	for (size_t row = 0; row < image_h; row++)
+		for (size_t col = 0; col < image_w; col++)
+			for (size_t ch = 0; ch < channels; ch++)
+				input[(row * image_w + col) * channels + ch] = (uint8_t)(row * (ch + 1) + col * 2 + ((col * 7) % 5));
+
+	struct akoSettings s = akoDefaultSettings();
+	s.tiles_dimension = tiles_dimension;
+	s.tiles_index = tiles_index;
+
+	struct akoCallbacks c = akoDefaultCallbacks();
+	c.threads = threads;
+
+	void* blob = NULL;
+	enum akoStatus status = AKO_ERROR;
+	const size_t blob_size = akoEncodeExt(&c, &s, channels, image_w, image_h, input, &blob, &status);
+	assert(blob_size != 0);
+
+	// Full decode, and region decode
+	uint8_t* image = akoDecodeExt(&c, blob_size, blob, NULL, NULL, NULL, NULL, NULL);
+	assert(image != NULL);
+
+	size_t out_w = 0;
+	size_t out_h = 0;
+	uint8_t* region = akoDecodeRegion(&c, blob_size, blob, x, y, w, h, NULL, NULL, &out_w, &out_h, &status);
+	assert(region != NULL);
+	assert(status == AKO_OK);
+	assert(out_w == image_w && out_h == image_h);
+
+	// Region should be identical to a crop
+	for (size_t row = 0; row < h; row++)
+		assert(memcmp(region + row * w * channels, image + ((y + row) * image_w + x) * channels, w * channels) == 0);
+
+	// Outside image
+	assert(akoDecodeRegion(&c, blob_size, blob, x, y, image_w - x + 1, h, NULL, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_INVALID_REGION);
+	assert(akoDecodeRegion(&c, blob_size, blob, 0, 0, 0, h, NULL, NULL, NULL, NULL, &status) == NULL);
+	assert(status == AKO_INVALID_REGION);
+
+	// Into a padded canvas, with an extra byte per pixel that should remain untouched
+	{
+		const size_t pitch = channels + 1;
+		const size_t stride = image_w * pitch + 7;
+		uint8_t* canvas = malloc(stride * image_h);
+		assert(canvas != NULL);
+		memset(canvas, 0xAA, stride * image_h);
+
+		assert(akoDecodeInto(&c, blob_size, blob, pitch, stride, canvas, NULL, NULL, NULL, NULL) == AKO_OK);
+
+		for (size_t row = 0; row < image_h; row++)
+			for (size_t col = 0; col < image_w; col++)
+			{
+				assert(memcmp(canvas + row * stride + col * pitch, image + (row * image_w + col) * channels,
+				              channels) == 0);
+				assert(canvas[row * stride + col * pitch + channels] == 0xAA);
+			}
+
+		assert(akoDecodeInto(&c, blob_size, blob, channels - 1, 0, canvas, NULL, NULL, NULL, NULL) ==
+		       AKO_INVALID_INPUT);
+		free(canvas);
+	}
+
+	// Encoding the region straight from the input, with its stride, should be the same as encoding a crop
+	{
+		uint8_t* crop = malloc(w * h * channels);
+		assert(crop != NULL);
+
+		for (size_t row = 0; row < h; row++)
+			memcpy(crop + row * w * channels, input + ((y + row) * image_w + x) * channels, w * channels);
+
+		void* a = NULL;
+		void* b = NULL;
+		const size_t a_size = akoEncodeExt(&c, &s, channels, w, h, crop, &a, NULL);
+		const size_t b_size = akoEncodeStrided(&c, &s, channels, w, h, image_w * channels,
+		                                       input + (y * image_w + x) * channels, &b, NULL);
+
+		assert(a_size == b_size); // Both may fail on tiny regions, as compression doesn't gain anything there
+		assert(a_size == 0 || memcmp(a, b, a_size) == 0);
+
+		if (a_size != 0)
+		{
+			akoDefaultFree(a);
+			akoDefaultFree(b);
+		}
+		free(crop);
+	}
+
+	// Bye!
+	akoDefaultFree(region);
+	akoDefaultFree(image);
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+int main()
+{
+	sTest(3, 100, 80, 0, 0, 1, 10, 20, 30, 40); // No tiles
+	sTest(3, 100, 80, 0, 0, 1, 0, 0, 100, 80);  // Whole image
+
+	sTest(4, 130, 70, 16, 0, 1, 5, 3, 60, 50);
+	sTest(4, 130, 70, 16, 1, 1, 5, 3, 60, 50);
+	sTest(3, 130, 70, 16, 0, 4, 5, 3, 60, 50);
+	sTest(3, 130, 70, 16, 1, 4, 129, 69, 1, 1); // Last pixel, in a border tile
+
+	sTest(4, 256, 128, 32, 0, 3, 32, 32, 32, 32); // Exactly one tile
+	sTest(3, 256, 128, 32, 1, 3, 31, 31, 2, 2);   // Four tiles, one pixel each
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "ako.h"
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void sTest(enum akoCompression compression, enum akoWavelet wavelet, size_t channels, size_t image_w,
+                  size_t image_h, size_t tiles_dimension)
+{
+	printf("Round trip test, compression: %i, wavelet: %i, %zu channels, %zux%zu px, tiles: %zu\n", compression,
+	       wavelet, channels, image_w, image_h, tiles_dimension);
+
+	// Something to encode, smooth enough to always compress
+	uint8_t* input = malloc(image_w * image_h * channels);
+	assert(input != NULL);
+
+	for (size_t row = 0; row < image_h; row++)
+		for (size_t col = 0; col < image_w; col++)
+			for (size_t ch = 0; ch < channels; ch++)
+				input[(row * image_w + col) * channels + ch] = (uint8_t)(row / 16 + col / 32 + ch * 16);
+
+	struct akoSettings s = akoDefaultSettings();
+	s.compression = compression;
+	s.wavelet = wavelet;
+	s.tiles_dimension = tiles_dimension;
+
+	// Without wavelet nor color transformation, nothing is lost
+	if (wavelet == AKO_WAVELET_NONE)
+		s.color = AKO_COLOR_NONE;
+
+	void* blob = NULL;
+	enum akoStatus status = AKO_ERROR;
+	const size_t blob_size = akoEncodeExt(NULL, &s, channels, image_w, image_h, input, &blob, &status);
+	assert(blob_size != 0);
+	assert(status == AKO_OK);
+
+	size_t out_channels = 0;
+	size_t out_w = 0;
+	size_t out_h = 0;
+	struct akoSettings out_s;
+	uint8_t* image = akoDecodeExt(NULL, blob_size, blob, &out_s, &out_channels, &out_w, &out_h, &status);
+	assert(image != NULL);
+	assert(status == AKO_OK);
+	assert(out_channels == channels && out_w == image_w && out_h == image_h);
+	assert(out_s.compression == compression && out_s.wavelet == wavelet);
+
+	if (wavelet == AKO_WAVELET_NONE)
+		assert(memcmp(image, input, image_w * image_h * channels) == 0);
+
+	// Bye!
+	akoDefaultFree(image);
+	akoDefaultFree(blob);
+	free(input);
+}
+
+
+int main()
+{
+	const size_t sizes[][2] = {{7, 5}, {8, 8}, {36, 20}, {64, 64}, {100, 12}};
+	const size_t tiles[] = {0, 8, 16};
+
+	for (int compression = AKO_COMPRESSION_KAGARI; compression <= AKO_COMPRESSION_MANBAVARAN; compression++)
+		for (int wavelet = AKO_WAVELET_DD137; wavelet <= AKO_WAVELET_NONE; wavelet++)
+			for (size_t channels = 1; channels <= 4; channels++)
+				for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+					for (size_t t = 0; t < sizeof(tiles) / sizeof(tiles[0]); t++)
+						sTest((enum akoCompression)compression, (enum akoWavelet)wavelet, channels, sizes[i][0],
+						      sizes[i][1], tiles[t]);
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include "ako.h"
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void sTest(const struct akoSettings* s, size_t channels, size_t image_w, size_t image_h)
+{
+	printf("Simd test, wavelet: %i, color: %i, quantization: %i, gate: %i, chroma loss: %i, discard: %i, %zu "
+	       "channels, %zux%zu px, tiles: %zu\n",
+	       s->wavelet, s->color, s->quantization, s->gate, s->chroma_loss, s->discard_non_visible, channels, image_w,
+	       image_h, s->tiles_dimension);
+
+	// Something to encode, with some noise and invisible pixels
+	uint8_t* input = malloc(image_w * image_h * channels);
+	assert(input != NULL);
+
+	uint32_t x = 666;
+	for (size_t i = 0; i < image_w * image_h * channels; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+
+		const size_t col = (i / channels) % image_w;
+		const size_t row = (i / channels) / image_w;
+		input[i] = (uint8_t)(col * 3 + row * 2 + (i % channels) * 40 + (x % 24));
+
+		if (channels == 4 && (i % channels) == 3 && (x % 5) == 0)
+			input[i] = 0;
+	}
+
+	// Encoding and decoding with every level should output the same as plain C code,
+	// which covers format, color transformation, quantization and gate kernels
+	void* reference_blob = NULL;
+	uint8_t* reference_image = NULL;
+	size_t reference_size = 0;
+
+	for (int simd = AKO_SIMD_NONE; simd <= (int)akoSimdDetected(); simd++)
+	{
+		if (akoSimdLimit((enum akoSimd)simd) != (enum akoSimd)simd)
+			continue;
+
+		void* blob = NULL;
+		enum akoStatus status = AKO_ERROR;
+		const size_t blob_size = akoEncodeExt(NULL, s, channels, image_w, image_h, input, &blob, &status);
+		assert(blob_size != 0);
+
+		uint8_t* image = akoDecodeExt(NULL, blob_size, blob, NULL, NULL, NULL, NULL, &status);
+		assert(image != NULL);
+
+		if (simd == AKO_SIMD_NONE)
+		{
+			reference_blob = blob;
+			reference_image = image;
+			reference_size = blob_size;
+			continue;
+		}
+
+		if (blob_size != reference_size || memcmp(blob, reference_blob, blob_size) != 0)
+			printf("Error, simd %i encoded differently\n", simd);
+		if (memcmp(image, reference_image, image_w * image_h * channels) != 0)
+			printf("Error, simd %i decoded differently\n", simd);
+
+		assert(blob_size == reference_size && memcmp(blob, reference_blob, blob_size) == 0);
+		assert(memcmp(image, reference_image, image_w * image_h * channels) == 0);
+
+		akoDefaultFree(image);
+		akoDefaultFree(blob);
+	}
+
+	// Bye!
+	akoSimdLimit(akoSimdDetected());
+	akoDefaultFree(reference_image);
+	akoDefaultFree(reference_blob);
+	free(input);
+}
+
+
+int main()
+{
+	printf("Simd detected: %i\n", akoSimdDetected());
+
+	for (int wavelet = AKO_WAVELET_DD137; wavelet <= AKO_WAVELET_HAAR; wavelet++)
+		for (int color = AKO_COLOR_YCOCG; color <= AKO_COLOR_NONE; color++)
+			for (size_t channels = 1; channels <= 4; channels++)
+			{
+				struct akoSettings s = akoDefaultSettings();
+				s.wavelet = (enum akoWavelet)wavelet;
+				s.color = (enum akoColor)color;
+
+				s.quantization = 0; // Lossless
+				s.gate = 0;
+				s.chroma_loss = 0;
+				sTest(&s, channels, 67, 45);
+
+				s.quantization = 16;
+				s.gate = 8;
+				s.chroma_loss = 2;
+				s.discard_non_visible = 1;
+				sTest(&s, channels, 67, 45);
+
+				s.tiles_dimension = 32;
+				sTest(&s, channels, 150, 70);
+			}
+
+	return 0;
+}
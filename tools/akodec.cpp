@@ -97,7 +97,7 @@ class AkoImage
 	size_t         get_blob_size() const   { return blob_size; };
 	// clang-format on
 
-	AkoImage(const std::string& filename, bool quiet, bool benchmark)
+	AkoImage(const std::string& filename, int scale, int threads, bool quiet, bool benchmark)
 	{
 		// Read file
 		auto blob = std::vector<uint8_t>();
@@ -125,19 +125,24 @@ class AkoImage
 			akoCallbacks callbacks = akoDefaultCallbacks();
 			akoStatus status = AKO_ERROR;
 
+			callbacks.threads = (size_t)threads;
+
 			if (benchmark == true && quiet == false)
 			{
 				total_benchmark.start(true);
 
-				EventsData events_data;
-				callbacks.events = EventsCallback;
-				callbacks.events_data = &events_data;
+				if (threads == 1) // Events, from multiple threads, will mess our stopwatches
+				{
+					EventsData events_data;
+					callbacks.events = EventsCallback;
+					callbacks.events_data = &events_data;
+				}
 
 				std::printf("Benchmark: \n");
 			}
 
-			data = (void*)akoDecodeExt(&callbacks, blob.size(), blob.data(), &settings, &channels, &width, &height,
-			                           &status);
+			data = (void*)akoDecodeScaled(&callbacks, blob.size(), blob.data(), (size_t)scale, &settings, &channels,
+			                              &width, &height, &status);
 
 			if (benchmark == true && quiet == false)
 				total_benchmark.pause_stop(true, " - Total: ");
@@ -160,8 +165,8 @@ class AkoImage
 };
 
 
-void AkoDec(const std::string& filename_input, const std::string& filename_output, int effort, bool verbose = false,
-            bool quiet = false, bool benchmark = false, bool checksum = false)
+void AkoDec(const std::string& filename_input, const std::string& filename_output, int effort, int scale = 0,
+            int threads = 1, bool verbose = false, bool quiet = false, bool benchmark = false, bool checksum = false)
 {
 	if (filename_input == "")
 		throw ErrorStr("No input filename specified");
@@ -172,12 +177,13 @@ void AkoDec(const std::string& filename_input, const std::string& filename_outpu
 		std::printf("Ako decoding tool v%i.%i.%i\n", TOOLS_VERSION_MAJOR, TOOLS_VERSION_MINOR, TOOLS_VERSION_PATCH);
 		std::printf(" - libako v%i.%i.%i, format %i\n", akoVersionMajor(), akoVersionMinor(), akoVersionPatch(),
 		            akoFormatVersion());
+		std::printf(" - simd level %i, detected %i\n", (int)akoSimdInUse(), (int)akoSimdDetected());
 		std::printf(" - lodepng %s\n", LODEPNG_VERSION_STRING);
 
 		std::printf("Opening input: '%s'...\n", filename_input.c_str());
 	}
 
-	const auto ako = AkoImage(filename_input, quiet, benchmark);
+	const auto ako = AkoImage(filename_input, scale, threads, quiet, benchmark);
 
 	if (verbose == true)
 		std::printf("Input data: %zu channels, %zux%zu px, wavelet: %i, color: %i, wrap: %i, compression: %i\n",
@@ -255,6 +261,8 @@ int main(int argc, const char* argv[])
 	std::string input_filename;
 	std::string output_filename;
 	int effort = 7;
+	int scale = 0;
+	int threads = 1;
 	bool verbose = false;
 	bool quiet = false;
 	bool benchmark = false;
@@ -281,6 +289,14 @@ int main(int argc, const char* argv[])
 		opts.add_integer("-e", "--effort", "Computational effort to encode output, from 1 to 10.", 7, 1, 10,
 		                 encoding_category);
 
+		const auto decoding_category = opts.add_category("DECODING OPTIONS");
+		opts.add_integer("-s", "--scale",
+		                 "Decode at a reduced size, 1 = half, 2 = quarter, 3 = eighth. Faster than decoding at full "
+		                 "size, as the finest details are never read.",
+		                 0, 0, AKO_MAX_SCALE, decoding_category);
+		opts.add_integer("-t", "--threads", "Number of threads to use, each one decodes a different tile.", 1, 1, 256,
+		                 decoding_category);
+
 		const auto extra_category = opts.add_category("EXTRA TOOLS");
 		opts.add_bool("-b", "--benchmark", "", extra_category);
 		opts.add_bool("-ch", "--checksum", "", extra_category);
@@ -321,6 +337,8 @@ int main(int argc, const char* argv[])
 		output_filename = opts.get_string("--output");
 
 		effort = opts.get_integer("--effort");
+		scale = opts.get_integer("--scale");
+		threads = opts.get_integer("--threads");
 		verbose = opts.get_bool("--verbose");
 		quiet = opts.get_bool("--quiet");
 		benchmark = opts.get_bool("--benchmark");
@@ -330,7 +348,7 @@ int main(int argc, const char* argv[])
 	// Decode!
 	try
 	{
-		AkoDec(input_filename, output_filename, effort, verbose, quiet, benchmark, checksum);
+		AkoDec(input_filename, output_filename, effort, scale, threads, verbose, quiet, benchmark, checksum);
 		return 0;
 	}
 	catch (ErrorStr& e)
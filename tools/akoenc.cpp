@@ -128,7 +128,28 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 	}
 
 	// Multiple passes to find a quantization value that
-	// place us close to the desired compression ratio
+	// place us close to the desired compression ratio. All of them
+	// with the same context and output, as only quantization changes
+	akoEncodeContext* context = akoEncodeContextCreate(callbacks, out_status);
+	if (context == NULL)
+		return 0;
+
+	const size_t output_size = akoEncodeBound(settings, channels, width, height);
+	void* output = callbacks->malloc(output_size);
+
+	if (output == NULL)
+	{
+		akoEncodeContextDelete(context);
+		*out_status = AKO_NO_ENOUGH_MEMORY;
+		return 0;
+	}
+
+	auto pass = [&](const akoSettings* pass_settings) -> size_t {
+		return akoEncodeWithContext(context, pass_settings, channels, width, height, 0, in, output_size, output,
+		                            out_status);
+	};
+
+	size_t size = 0;
 	{
 		const size_t target_size = (width * height * channels) / ratio;
 		const size_t error_margin = (target_size * 4) / 100;
@@ -141,7 +162,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 		auto new_settings = *settings;
 		new_settings.quantization = 0;
 
-		size_t ceil_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+		size_t ceil_size = pass(&new_settings);
 
 		// Exponentially find a floor
 		new_settings.quantization = 1;
@@ -156,7 +177,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 			ceil_size = floor_size;
 			ceil_q = floor_q;
 
-			floor_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+			floor_size = pass(&new_settings);
 			floor_q = new_settings.quantization;
 
 			if (verbose == true)
@@ -171,7 +192,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 		       std::abs(floor_q - ceil_q) > 1)
 		{
 			new_settings.quantization = (ceil_q + floor_q) / 2;
-			last_size = akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+			last_size = pass(&new_settings);
 
 			if (last_size > target_size)
 			{
@@ -189,7 +210,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 				            (double)floor_size / 1000.0F);
 		}
 
-		// Bye!
+		// Last pass, unless it was already done
 		if (std::max(floor_size, target_size) - std::min(floor_size, target_size) <
 		    std::max(ceil_size, target_size) - std::min(ceil_size, target_size))
 		{
@@ -197,8 +218,7 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 				std::printf(" - Q: %i\n", floor_q);
 
 			new_settings.quantization = floor_q;
-			if (last_size == floor_size)
-				return last_size;
+			size = (last_size == floor_size) ? last_size : pass(&new_settings);
 		}
 		else
 		{
@@ -206,19 +226,27 @@ size_t EncodePass(bool verbose, int ratio, const akoCallbacks* callbacks, const
 				std::printf(" - Q: %i\n", ceil_q);
 
 			new_settings.quantization = ceil_q;
-			if (last_size == ceil_size)
-				return last_size;
+			size = (last_size == ceil_size) ? last_size : pass(&new_settings);
 		}
+	}
 
-		return akoEncodeExt(callbacks, &new_settings, channels, width, height, in, out, out_status);
+	// Bye!
+	akoEncodeContextDelete(context);
+
+	if (size == 0)
+	{
+		callbacks->free(output);
+		return 0;
 	}
 
-	return 0;
+	*out = output;
+	return size;
 }
 
 
 void AkoEnc(const akoSettings& settings, const std::string& filename_input, const std::string& filename_output,
-            int ratio = 0, bool verbose = false, bool quiet = false, bool benchmark = false, bool checksum = false)
+            int ratio = 0, int threads = 1, bool verbose = false, bool quiet = false, bool benchmark = false,
+            bool checksum = false)
 {
 	if (filename_input == "")
 		throw ErrorStr("No input filename specified");
@@ -229,6 +257,7 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 		std::printf("Ako encoding tool v%i.%i.%i\n", VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
 		std::printf(" - libako v%i.%i.%i, format %i\n", akoVersionMajor(), akoVersionMinor(), akoVersionPatch(),
 		            akoFormatVersion());
+		std::printf(" - simd level %i, detected %i\n", (int)akoSimdInUse(), (int)akoSimdDetected());
 		std::printf(" - lodepng %s\n", LODEPNG_VERSION_STRING);
 
 		std::printf("Opening input: '%s'...\n", filename_input.c_str());
@@ -253,6 +282,8 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 		std::printf(", color: %i", (int)settings.color);
 		std::printf(", wrap: %i", (int)settings.wrap);
 		std::printf(", compression %i", (int)settings.compression);
+		std::printf(", tiles dimension: %zu", settings.tiles_dimension);
+		std::printf(", tiles index: %i", (int)settings.tiles_index);
 		std::printf(", chroma loss: %i", (int)settings.chroma_loss);
 		std::printf(", discard non-visible: %i]\n", (int)settings.discard_non_visible);
 	}
@@ -264,11 +295,13 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 		akoCallbacks callbacks = akoDefaultCallbacks();
 		akoStatus status = AKO_ERROR;
 
+		callbacks.threads = (size_t)threads;
+
 		if (benchmark == true && quiet == false)
 		{
 			total_benchmark.start(true);
 
-			if (ratio == 0)
+			if (ratio == 0 && threads == 1) // Events, from multiple threads, will mess our stopwatches
 			{
 				EventsData events_data;
 				callbacks.events = EventsCallback;
@@ -282,7 +315,7 @@ void AkoEnc(const akoSettings& settings, const std::string& filename_input, cons
 
 		if (benchmark == true && quiet == false)
 		{
-			if (ratio != 0)
+			if (ratio != 0 || threads != 1)
 				std::printf("Benchmark: \n");
 
 			total_benchmark.pause_stop(true, " - Total: ");
@@ -328,6 +361,7 @@ int main(int argc, const char* argv[])
 	std::string input_filename;
 	std::string output_filename;
 	int ratio = 0;
+	int threads = 1;
 	bool verbose = false;
 	bool quiet = false;
 	bool benchmark = false;
@@ -382,6 +416,20 @@ int main(int argc, const char* argv[])
 		              "lossless compression do not set this option.",
 		              encoding_category);
 
+		opts.add_integer("-td", "--tiles-dimension",
+		                 "Splits the image in tiles of the provided dimension, encoded independently. Should be a "
+		                 "power-of-two equal or greater than 8. Set it to zero to encode the whole image as a "
+		                 "single tile.",
+		                 0, 0, 1048576, encoding_category);
+		opts.add_bool("-ti", "--tiles-index",
+		              "Write an index of where each tile begins in the file, so decoders can locate tiles without "
+		              "reading all previous ones. Costs eight bytes per tile.",
+		              encoding_category);
+		opts.add_integer("-t", "--threads",
+		                 "Number of threads to use, each one encodes a different tile. Only meaningful with "
+		                 "'--tiles-dimension' set.",
+		                 1, 1, 256, encoding_category);
+
 		const auto extra_category = opts.add_category("EXTRA TOOLS");
 		opts.add_bool("-b", "--benchmark", "", extra_category);
 		opts.add_bool("-ch", "--checksum", "", extra_category);
@@ -433,6 +481,7 @@ int main(int argc, const char* argv[])
 		quiet = opts.get_bool("--quiet");
 		benchmark = opts.get_bool("--benchmark");
 		checksum = opts.get_bool("--checksum");
+		threads = opts.get_integer("--threads");
 
 		settings.quantization = opts.get_integer("--quantization");
 		settings.gate = opts.get_integer("--noise-gate");
@@ -441,6 +490,8 @@ int main(int argc, const char* argv[])
 		settings.color = (akoColor)opts.get_string_index("--color");
 		settings.wrap = (akoWrap)opts.get_string_index("--wrap");
 		settings.chroma_loss = opts.get_integer("--chroma-loss");
+		settings.tiles_dimension = (size_t)opts.get_integer("--tiles-dimension");
+		settings.tiles_index = opts.get_bool("--tiles-index");
 
 		ratio = opts.get_integer("--dev-ratio");
 		settings.compression = (akoCompression)opts.get_string_index("--dev-compression");
@@ -449,7 +500,7 @@ int main(int argc, const char* argv[])
 	// Encode!
 	try
 	{
-		AkoEnc(settings, input_filename, output_filename, ratio, verbose, quiet, benchmark, checksum);
+		AkoEnc(settings, input_filename, output_filename, ratio, threads, verbose, quiet, benchmark, checksum);
 		return 0;
 	}
 	catch (ErrorStr& e)